@@ -2,9 +2,11 @@
 
 #include <bdn/ApplicationController.h>
 #include <bdn/DispatchQueue.h>
+#include <bdn/ThreadPool.h>
 
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <thread>
 #include <utility>
 
@@ -44,6 +46,11 @@ namespace bdn
 
       public:
         std::shared_ptr<DispatchQueue> dispatchQueue();
+
+        /** Shared pool for background work, created on first use.
+            Completions passed to ThreadPool::dispatchAsync() run on
+            dispatchQueue(). */
+        std::shared_ptr<ThreadPool> threadPool();
         std::shared_ptr<ApplicationController> applicationController();
 
       public:
@@ -70,6 +77,9 @@ namespace bdn
         std::shared_ptr<ApplicationController> _applicationController;
         std::shared_ptr<DispatchQueue> _mainDispatchQueue;
 
+        std::mutex _threadPoolMutex;
+        std::shared_ptr<ThreadPool> _threadPool;
+
         static std::thread::id _mainThreadId;
 
         bool _appControllerBeginLaunchCalled = false;
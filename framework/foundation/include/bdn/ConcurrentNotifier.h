@@ -0,0 +1,268 @@
+#pragma once
+
+#include <bdn/Notifier.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace bdn
+{
+    namespace detail
+    {
+        /** Per-thread slots through which ConcurrentNotifier readers announce
+            the snapshot they hold and the subscriber they are about to call
+            (hazard pointers). Each nesting level of notify() on a thread owns
+            one slot and only its owner writes to it, so readers never write
+            memory that other threads write. Writers scan all slots.
+
+            Slots are kept for the lifetime of the process and reused by later
+            threads once their owner exits.
+        */
+        class NotifierHazards
+        {
+          public:
+            struct alignas(64) Slot
+            {
+                std::atomic<const void *> snapshot{nullptr};
+                std::atomic<const void *> calling{nullptr};
+                std::atomic<bool> inUse{false};
+                Slot *next = nullptr;
+            };
+
+            /** Claims the calling thread's slot for one notify() */
+            class Scope
+            {
+              public:
+                Scope();
+                ~Scope();
+                Scope(const Scope &) = delete;
+                Scope &operator=(const Scope &) = delete;
+
+                /** Loads source and announces the result. Once it returns,
+                    the pointee is not freed before the scope ends. */
+                template <class T> T *protect(const std::atomic<T *> &source)
+                {
+                    auto pointer = source.load();
+                    for (;;) {
+                        _slot->snapshot.store(pointer);
+                        auto again = source.load();
+                        if (again == pointer) {
+                            return pointer;
+                        }
+                        pointer = again;
+                    }
+                }
+
+                /** Must be followed by checking whether subscriber was
+                    disabled before calling it. */
+                void call(const void *subscriber) { _slot->calling.store(subscriber); }
+
+              private:
+                Slot *_slot;
+            };
+
+            static bool isSnapshotHeld(const void *snapshot);
+            static bool isCalledOnThisThread(const void *subscriber);
+            static void waitWhileCalledElsewhere(const void *subscriber);
+        };
+    }
+
+    /** Notifier that may be used from any number of threads at once.
+
+        notify() works on an immutable snapshot of the subscriber list. It
+        takes no lock and does no read-modify-write on shared memory, so
+        notifications from different threads run in parallel without
+        contending. subscribe() and unsubscribe() copy the list, change the
+        copy and publish it, which makes them O(n) and serialises them against
+        each other only. A replaced snapshot is freed by the next change once
+        no notify() holds it anymore, so at most one snapshot per running
+        notify() is kept around.
+
+        Subscribers added while a notification is running are only called by
+        later notifications. Once unsubscribe() returns the subscriber is not
+        called anymore and no call is running on another thread. A subscriber
+        may unsubscribe itself, but it must not wait for another thread that
+        unsubscribes it.
+
+        Targets may be called concurrently and have to be thread-safe. The
+        notifier itself must not be destroyed while notify() runs.
+    */
+    template <class... Arguments> class ConcurrentNotifier
+    {
+      public:
+        using Subscription = NotifierSubscription;
+        using Target = typename Notifier<Arguments...>::Target;
+
+      public:
+        ConcurrentNotifier() = default;
+        ConcurrentNotifier(const ConcurrentNotifier &) = delete;
+        ConcurrentNotifier &operator=(const ConcurrentNotifier &) = delete;
+
+        ~ConcurrentNotifier()
+        {
+            delete _current.load();
+            for (auto snapshot : _retired) {
+                delete snapshot;
+            }
+        }
+
+      public:
+        Subscription subscribe(Target target)
+        {
+            auto subscriber = std::make_shared<Subscriber>(std::move(target));
+            auto generation = Subscription::nextGeneration();
+            subscriber->generation = generation;
+
+            std::lock_guard<std::mutex> lk(_writeMutex);
+            auto current = _current.load();
+            auto snapshot = new Snapshot(current->subscribers);
+            snapshot->subscribers.push_back(std::move(subscriber));
+            publish(snapshot);
+
+            return Subscription(0, generation);
+        }
+
+        /** See Notifier::subscribe(Target, const std::shared_ptr<DispatchQueue> &, CoalescePolicy). */
+        Subscription subscribe(Target target, const std::shared_ptr<DispatchQueue> &queue,
+                               CoalescePolicy policy = CoalescePolicy::None)
+        {
+            return subscribe(detail::QueuedNotifierTarget<Arguments...>(std::move(target), queue, policy));
+        }
+
+        /** Does nothing if subscription was removed already. Waits for calls
+            of the subscriber that run on other threads. */
+        void unsubscribe(Subscription subscription)
+        {
+            if (!subscription) {
+                return;
+            }
+
+            std::shared_ptr<Subscriber> removed;
+            {
+                std::lock_guard<std::mutex> lk(_writeMutex);
+                auto current = _current.load();
+                auto snapshot = new Snapshot;
+                snapshot->subscribers.reserve(current->subscribers.size());
+                for (auto &subscriber : current->subscribers) {
+                    if (subscriber->generation == subscription._generation) {
+                        removed = subscriber;
+                    } else {
+                        snapshot->subscribers.push_back(subscriber);
+                    }
+                }
+
+                if (!removed) {
+                    delete snapshot;
+                    return;
+                }
+                publish(snapshot);
+            }
+
+            removed->disable();
+        }
+
+        void unsubscribeAll()
+        {
+            std::vector<std::shared_ptr<Subscriber>> removed;
+            {
+                std::lock_guard<std::mutex> lk(_writeMutex);
+                removed = _current.load()->subscribers;
+                if (removed.empty()) {
+                    return;
+                }
+                publish(new Snapshot);
+            }
+
+            for (auto &subscriber : removed) {
+                subscriber->disable();
+            }
+        }
+
+        ConcurrentNotifier<Arguments...> &operator+=(Target target)
+        {
+            subscribe(std::move(target));
+            return *this;
+        }
+
+        bool empty() const
+        {
+            std::lock_guard<std::mutex> lk(_writeMutex);
+            return _current.load()->subscribers.empty();
+        }
+
+      public:
+        void notify(Arguments... arguments)
+        {
+            detail::NotifierHazards::Scope scope;
+            auto snapshot = scope.protect(_current);
+
+            for (auto &subscriber : snapshot->subscribers) {
+                scope.call(subscriber.get());
+                if (!subscriber->disabled.load()) {
+                    subscriber->target(arguments...);
+                }
+            }
+        }
+
+      private:
+        struct Subscriber
+        {
+            explicit Subscriber(Target t) : target(std::move(t)) {}
+
+            // Calls that started before disabled was set may still be
+            // running. Wait for them, except those up the caller's own stack.
+            // Destroys the target right away unless one of those is running,
+            // since retired snapshots may keep the subscriber alive for a while.
+            void disable()
+            {
+                disabled.store(true);
+
+                auto own = detail::NotifierHazards::isCalledOnThisThread(this);
+                detail::NotifierHazards::waitWhileCalledElsewhere(this);
+
+                if (!own) {
+                    target = nullptr;
+                }
+            }
+
+            Target target;
+            uint64_t generation = 0;
+            std::atomic<bool> disabled{false};
+        };
+
+        struct Snapshot
+        {
+            Snapshot() = default;
+            explicit Snapshot(const std::vector<std::shared_ptr<Subscriber>> &s) : subscribers(s) {}
+
+            std::vector<std::shared_ptr<Subscriber>> subscribers;
+        };
+
+        // Called with _writeMutex held. Frees every replaced snapshot that no
+        // reader announces; readers that load the new one never see the others.
+        void publish(Snapshot *snapshot)
+        {
+            _retired.push_back(_current.exchange(snapshot));
+
+            auto kept = _retired.begin();
+            for (auto retired : _retired) {
+                if (detail::NotifierHazards::isSnapshotHeld(retired)) {
+                    *kept++ = retired;
+                } else {
+                    delete retired;
+                }
+            }
+            _retired.erase(kept, _retired.end());
+        }
+
+      private:
+        std::atomic<Snapshot *> _current{new Snapshot};
+
+        mutable std::mutex _writeMutex;
+        std::vector<Snapshot *> _retired;
+    };
+}
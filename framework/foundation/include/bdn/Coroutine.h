@@ -0,0 +1,253 @@
+#pragma once
+
+#include <bdn/DispatchQueue.h>
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#define BDN_HAS_COROUTINES 1
+
+namespace bdn::co
+{
+    template <class T = void> class Task;
+
+    namespace detail
+    {
+        class PromiseBase
+        {
+          public:
+            // Symmetric transfer to whoever awaited us, no stack growth on
+            // long chains of awaited tasks.
+            struct FinalAwaiter
+            {
+                bool await_ready() const noexcept { return false; }
+
+                template <class Promise>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) const noexcept
+                {
+                    if (auto continuation = handle.promise().continuation()) {
+                        return continuation;
+                    }
+                    return std::noop_coroutine();
+                }
+
+                void await_resume() const noexcept {}
+            };
+
+          public:
+            std::suspend_always initial_suspend() const noexcept { return {}; }
+            FinalAwaiter final_suspend() const noexcept { return {}; }
+            void unhandled_exception() noexcept { _exception = std::current_exception(); }
+
+            std::coroutine_handle<> continuation() const { return _continuation; }
+            void setContinuation(std::coroutine_handle<> continuation) { _continuation = continuation; }
+
+          protected:
+            void rethrowIfFailed()
+            {
+                if (_exception) {
+                    std::rethrow_exception(_exception);
+                }
+            }
+
+          private:
+            std::coroutine_handle<> _continuation;
+            std::exception_ptr _exception;
+        };
+
+        template <class T> class Promise : public PromiseBase
+        {
+          public:
+            Task<T> get_return_object() noexcept;
+
+            template <class U> void return_value(U &&value) { _value.emplace(std::forward<U>(value)); }
+
+            T result()
+            {
+                rethrowIfFailed();
+                return std::move(*_value);
+            }
+
+          private:
+            std::optional<T> _value;
+        };
+
+        template <> class Promise<void> : public PromiseBase
+        {
+          public:
+            Task<void> get_return_object() noexcept;
+
+            void return_void() noexcept {}
+
+            void result() { rethrowIfFailed(); }
+        };
+    }
+
+    /** Coroutine returning a T.
+
+        A Task does not start until it is awaited. co_await-ing it runs it on
+        the awaiting thread and resumes the awaiter once it finished, either
+        with its result or by rethrowing its exception. Use spawn() to start a
+        task from non-coroutine code.
+
+        Destroying a suspended Task destroys its frame including all tasks it
+        is currently awaiting. Pending delay() timers are cancelled by that.
+        This must happen on the thread that would resume the task.
+    */
+    template <class T> class Task
+    {
+      public:
+        using promise_type = detail::Promise<T>;
+        using Handle = std::coroutine_handle<promise_type>;
+
+      public:
+        Task() = default;
+        Task(Task &&other) noexcept : _handle(std::exchange(other._handle, nullptr)) {}
+        Task &operator=(Task &&other) noexcept
+        {
+            if (this != &other) {
+                reset();
+                _handle = std::exchange(other._handle, nullptr);
+            }
+            return *this;
+        }
+        Task(const Task &) = delete;
+        Task &operator=(const Task &) = delete;
+
+        ~Task() { reset(); }
+
+      public:
+        explicit operator bool() const { return static_cast<bool>(_handle); }
+
+        bool await_ready() const noexcept { return false; }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+        {
+            _handle.promise().setContinuation(awaiting);
+            return _handle;
+        }
+
+        T await_resume() { return _handle.promise().result(); }
+
+      private:
+        friend class detail::Promise<T>;
+        explicit Task(Handle handle) : _handle(handle) {}
+
+        void reset()
+        {
+            if (_handle) {
+                std::exchange(_handle, nullptr).destroy();
+            }
+        }
+
+      private:
+        Handle _handle;
+    };
+
+    namespace detail
+    {
+        template <class T> Task<T> Promise<T>::get_return_object() noexcept
+        {
+            return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+        }
+
+        inline Task<void> Promise<void>::get_return_object() noexcept
+        {
+            return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+        }
+
+        struct Detached
+        {
+            struct promise_type
+            {
+                Detached get_return_object() const noexcept { return {}; }
+                std::suspend_never initial_suspend() const noexcept { return {}; }
+                std::suspend_never final_suspend() const noexcept { return {}; }
+                void return_void() const noexcept {}
+                void unhandled_exception() const noexcept { std::terminate(); }
+            };
+        };
+
+        template <class T, class Completion> Detached runDetached(Task<T> task, Completion completion)
+        {
+            if constexpr (std::is_void_v<T>) {
+                co_await std::move(task);
+                completion();
+            } else {
+                completion(co_await std::move(task));
+            }
+        }
+    }
+
+    /** Starts task on the calling thread and lets it finish on its own. An
+        exception escaping the task terminates the program. */
+    template <class T> void spawn(Task<T> task)
+    {
+        detail::runDetached(std::move(task), [](auto &&...) {});
+    }
+
+    /** Like spawn(), but calls completion with the task's result (if any)
+        on whatever thread the task finished on. */
+    template <class T, class Completion> void spawn(Task<T> task, Completion completion)
+    {
+        detail::runDetached(std::move(task), std::move(completion));
+    }
+
+    /** Awaitable returned by delay(). */
+    class DelayAwaiter
+    {
+      public:
+        DelayAwaiter(DispatchQueue &queue, DispatchQueue::Clock::duration delay) : _queue(queue), _delay(delay) {}
+        DelayAwaiter(const DelayAwaiter &) = delete;
+        DelayAwaiter &operator=(const DelayAwaiter &) = delete;
+
+        // Only reached with a pending timer if the suspended frame is destroyed
+        ~DelayAwaiter() { _token.cancel(); }
+
+        bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            // Timers run straight from the queue's timer wheel, so once the
+            // token is cancelled the handle is never touched again. The
+            // TickFunction overload keeps the handle inline instead of
+            // wrapping a std::function in another one.
+            auto resume = [handle](uint64_t) {
+                handle.resume();
+                return false;
+            };
+            _token = _queue.createTimer(_delay, DispatchQueue::TickFunction(resume));
+        }
+
+        void await_resume() noexcept { _token = {}; }
+
+      private:
+        DispatchQueue &_queue;
+        DispatchQueue::Clock::duration _delay;
+        DispatchQueue::CancellationToken _token;
+    };
+
+    /** co_await delay(queue, 200ms) resumes the coroutine on queue once
+        duration has passed. */
+    template <class Rep, class Period>
+    DelayAwaiter delay(DispatchQueue &queue, std::chrono::duration<Rep, Period> duration)
+    {
+        return DelayAwaiter(queue, std::chrono::duration_cast<DispatchQueue::Clock::duration>(duration));
+    }
+
+    template <class Rep, class Period>
+    DelayAwaiter delay(const std::shared_ptr<DispatchQueue> &queue, std::chrono::duration<Rep, Period> duration)
+    {
+        return delay(*queue, duration);
+    }
+}
+
+#endif
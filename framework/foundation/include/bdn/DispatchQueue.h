@@ -1,256 +1,643 @@
 #pragma once
 
+#include <bdn/LatencyHistogram.h>
+#include <bdn/MPSCQueue.h>
+#include <bdn/Task.h>
+#include <bdn/TimingWheel.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
-#include <future>
-#include <map>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <optional>
-#include <queue>
+#include <stdexcept>
 #include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 
 namespace bdn
 {
+    class VirtualClock;
+
     class DispatchQueue
     {
       public:
-        using Function = std::function<void()>;
+        using Function = Task;
         using Clock = std::chrono::steady_clock;
         using TimePoint = Clock::time_point;
 
+        /** Lanes in which functions wait for execution. Higher lanes run
+            first. A function that waited longer than its lane's aging
+            threshold (DefaultAging, BackgroundAging) is run before any other
+            lane so that lower lanes still make progress under load. */
+        enum class Priority
+        {
+            Interactive,
+            Default,
+            Background
+        };
+
+        static constexpr size_t PriorityCount = 3;
+        static constexpr Clock::duration DefaultAging = std::chrono::milliseconds(50);
+        static constexpr Clock::duration BackgroundAging = std::chrono::milliseconds(250);
+
+        /** Default for setProcessBudget(), half a frame at 60Hz. */
+        static constexpr Clock::duration DefaultProcessBudget = std::chrono::milliseconds(8);
+
+        /** How processing passes went, see setProcessBudget(). */
+        struct ProcessMetrics
+        {
+            uint64_t passes = 0;
+            uint64_t budgetExhausted = 0;
+            Clock::duration longestPass{};
+        };
+
+        /** Time functions spent waiting in a lane before they started. */
+        struct WaitMetrics
+        {
+            uint64_t count = 0;
+            Clock::duration total{};
+            Clock::duration max{};
+
+            Clock::duration mean() const
+            {
+                return count > 0 ? total / static_cast<Clock::rep>(count) : Clock::duration{};
+            }
+        };
+
+        /** Where a queue takes the current time from. Queues without one use
+            Clock directly. See VirtualClock. */
+        class TimeSource
+        {
+          public:
+            virtual ~TimeSource() = default;
+
+            virtual TimePoint now() const = 0;
+
+            /** True if time only moves when the source says so. Queues then
+                never wait for a deadline on their own but rely on the source
+                to drive them. */
+            virtual bool isVirtual() const { return false; }
+
+          protected:
+            friend class DispatchQueue;
+
+            /** Called by every queue using this source on construction and
+                destruction. */
+            virtual void attach(DispatchQueue *queue) {}
+            virtual void detach(DispatchQueue *queue) {}
+        };
+
+        /** Passed to functions queued with dispatchWhenIdle(). */
+        struct IdleDeadline
+        {
+            TimePoint end;
+
+            /** True if the function runs because its deadline passed, not
+                because the queue was idle. */
+            bool didTimeout = false;
+
+            const TimeSource *timeSource = nullptr;
+
+            /** How much longer the function may run before the queue expects
+                to have other work. */
+            Clock::duration timeRemaining() const
+            {
+                auto now = timeSource != nullptr ? timeSource->now() : Clock::now();
+                return std::max(Clock::duration::zero(), end - now);
+            }
+        };
+
+        using IdleFunction = UniqueFunction<void(const IdleDeadline &)>;
+
+        /** Longest idle period handed to idle functions in one go. */
+        static constexpr Clock::duration MaxIdlePeriod = std::chrono::milliseconds(50);
+
+        /** Idle periods shorter than this are not used at all. */
+        static constexpr Clock::duration MinIdlePeriod = std::chrono::milliseconds(1);
+
+        /** What a repeating timer does if it fell behind by one or more
+            intervals, e.g. because the queue was blocked. */
+        enum class MissedTickPolicy
+        {
+            /** One call for all due ticks, missedTicks tells how many were
+                dropped. The following ticks stay on the original schedule. */
+            Coalesce,
+            /** One call per due tick, back to back, until the timer is back on
+                schedule. missedTicks is always 0. */
+            CatchUp,
+            /** Like Coalesce, but the schedule starts over from the time of
+                the call. */
+            Skip
+        };
+
+        /** Called by repeating timers. Returns false to stop the timer. */
+        using TickFunction = std::function<bool(uint64_t missedTicks)>;
+
+        /** Where a function was dispatched from. Only filled in if
+            BDN_DISPATCH_INSTRUMENTATION is enabled. */
+        struct SourceTag
+        {
+#ifdef BDN_DISPATCH_INSTRUMENTATION
+            const char *file = nullptr;
+            const char *function = nullptr;
+            int line = 0;
+
+            static constexpr SourceTag current(const char *file = __builtin_FILE(),
+                                               const char *function = __builtin_FUNCTION(),
+                                               int line = __builtin_LINE())
+            {
+                return SourceTag{file, function, line};
+            }
+#else
+            static constexpr SourceTag current() { return SourceTag{}; }
+#endif
+        };
+
+        static constexpr bool InstrumentationEnabled =
+#ifdef BDN_DISPATCH_INSTRUMENTATION
+            true;
+#else
+            false;
+#endif
+
+        /** Collected if BDN_DISPATCH_INSTRUMENTATION is enabled, otherwise
+            statistics() always returns an empty object. Timers are included
+            in runTime but not in waitTime. */
+        struct Statistics
+        {
+            LatencyHistogram waitTime;
+            LatencyHistogram runTime;
+
+            /** Functions waiting in the lanes right now and at most. */
+            size_t depth = 0;
+            size_t maxDepth = 0;
+
+            /** Delayed functions and timers right now and at most. */
+            size_t timedDepth = 0;
+            size_t maxTimedDepth = 0;
+
+            /** How often the worker was woken up to process the queue. */
+            uint64_t wakeups = 0;
+
+            uint64_t slowTasks = 0;
+        };
+
+        /** Passed to the slow task handler, see setSlowTaskHandler(). */
+        struct SlowTask
+        {
+            SourceTag source;
+            Priority priority = Priority::Default;
+            Clock::duration waitTime{};
+            Clock::duration runTime{};
+        };
+
       protected:
         using MutexType = std::mutex;
         using LockType = std::unique_lock<MutexType>;
 
       public:
-        DispatchQueue(bool slave = false) : _slave(slave)
-        {
-            if (!_slave) {
-                _thread = std::make_unique<std::thread>(std::bind(&DispatchQueue::workerThread, this));
-                _threadId = _thread->get_id();
-            }
-        }
-        virtual ~DispatchQueue()
+        /** Returned by dispatchAsyncDelayed() and createTimer(). Cancelling
+            removes the task from the queue right away, a cancelled timer is
+            never called again.
+
+            A token must not be used after its DispatchQueue was destroyed.
+        */
+        class CancellationToken
         {
-            cancel();
-            if (_thread) {
-                _thread->join();
-                _thread.reset();
+          public:
+            CancellationToken() = default;
+
+            /** Returns true if a pending task or running timer was cancelled. */
+            bool cancel()
+            {
+                if (_queue == nullptr) {
+                    return false;
+                }
+                return std::exchange(_queue, nullptr)->cancelTimed(_id);
             }
-        }
+
+            explicit operator bool() const { return _queue != nullptr; }
+
+          private:
+            friend class DispatchQueue;
+            CancellationToken(DispatchQueue *queue, uint64_t id) : _queue(queue), _id(id) {}
+
+            DispatchQueue *_queue = nullptr;
+            uint64_t _id = 0;
+        };
 
       public:
-        void dispatchAsync(Function function)
+        DispatchQueue(bool slave = false, std::shared_ptr<TimeSource> timeSource = nullptr);
+        virtual ~DispatchQueue();
+
+      public:
+        /** The time all deadlines and wait times of this queue refer to. */
+        TimePoint now() const { return _timeSource ? _timeSource->now() : Clock::now(); }
+
+        std::shared_ptr<TimeSource> timeSource() const { return _timeSource; }
+
+      public:
+        void dispatchAsync(Function function, Priority priority = Priority::Default,
+                           SourceTag source = SourceTag::current())
         {
-            LockType lk(_queueMutex);
-            dispatchAsync(std::move(function), lk);
+            if (_cancelled) {
+                return;
+            }
+
+            // Only the producer that turns a lane non-empty has to wake the
+            // worker. Everybody else never touches the mutex.
+            if (lane(priority).push(makeQueuedTask(std::move(function), now(), source))) {
+                LockType lk(_queueMutex);
+                notifyWorker(lk);
+            }
+
+#ifdef BDN_DISPATCH_INSTRUMENTATION
+            recordDepth();
+#endif
         }
 
-        void dispatchSync(Function function)
+        /** Identifies work queued with dispatchAsyncCoalesced(), usually the
+            address of the object the work is about. */
+        using CoalesceKey = const void *;
+
+        /** Like dispatchAsync(), but if a function queued with the same key
+            has not started yet, function replaces it instead of being queued
+            a second time. The replacement keeps the place and priority of
+            the waiting function. Callers that need to merge rather than
+            replace keep the merged state in their own object.
+
+            Returns true if function was queued, false if it replaced a
+            waiting one. */
+        bool dispatchAsyncCoalesced(CoalesceKey key, Function function, Priority priority = Priority::Default,
+                                    SourceTag source = SourceTag::current());
+
+        /** Runs function on the queue and blocks until it has finished.
+            Returns whatever function returns, exceptions are rethrown in the
+            calling thread.
+
+            If the queue is cancelled before function started a function
+            returning void is silently dropped, otherwise std::runtime_error
+            is thrown.
+        */
+        template <class F>
+        auto dispatchSync(F &&function, Priority priority = Priority::Default) -> std::invoke_result_t<F &>
         {
+            using Result = std::invoke_result_t<F &>;
+            static_assert(!std::is_reference_v<Result>, "dispatchSync() cannot return references");
+
             if (std::this_thread::get_id() == _threadId) {
-                function();
-                return;
+                return function();
             }
 
-            LockType lk(_queueMutex);
-            if (_cancelled) {
-                return;
-            }
+            using Storage = std::conditional_t<std::is_void_v<Result>, bool, Result>;
+            std::optional<Storage> result;
+            std::exception_ptr error;
+            SyncWaiter waiter;
+
+            dispatchAsync(
+                [this, &waiter, &function, &result, &error]() {
+                    try {
+                        if constexpr (std::is_void_v<Result>) {
+                            function();
+                            result.emplace(true);
+                        } else {
+                            result.emplace(function());
+                        }
+                    }
+                    catch (...) {
+                        error = std::current_exception();
+                    }
+                    completeSyncWaiter(waiter);
+                },
+                priority);
 
-            std::packaged_task<void()> task(function);
-            auto future = task.get_future();
-            dispatchAsync(std::ref(task), lk);
+            waitForSyncWaiter(waiter);
 
-            lk.unlock();
-            while (!_cancelled) {
-                if (future.wait_for(std::chrono::milliseconds(10)) == std::future_status::ready)
-                    break;
+            if (error) {
+                std::rethrow_exception(error);
+            }
+            if (!result) {
+                return cancelledSyncResult<Result>();
+            }
+            if constexpr (!std::is_void_v<Result>) {
+                return std::move(*result);
             }
         }
 
+        /** Once delay has passed function is queued in the lane for
+            priority. Its wait time is measured from the deadline.
+
+            leeway allows the queue to run function up to that much later
+            than requested, so that it can share a wakeup with other delayed
+            functions and timers. */
         template <class _Rep, class _Period>
-        void dispatchAsyncDelayed(std::chrono::duration<_Rep, _Period> delay, Function function)
+        CancellationToken dispatchAsyncDelayed(std::chrono::duration<_Rep, _Period> delay, Function function,
+                                               Priority priority = Priority::Default,
+                                               Clock::duration leeway = Clock::duration::zero(),
+                                               SourceTag source = SourceTag::current())
         {
             LockType lk(_queueMutex);
 
-            TimePoint executeTimePoint = Clock::now() + std::chrono::duration_cast<Clock::duration>(delay);
-            _timedQueue[executeTimePoint].push(std::move(function));
+            TimePoint executeTimePoint = now() + std::chrono::duration_cast<Clock::duration>(delay);
+            TimedTask task{std::move(function), nullptr, {}, executeTimePoint, priority, leeway};
+#ifdef BDN_DISPATCH_INSTRUMENTATION
+            task.source = source;
+#endif
+            auto handle = _timedQueue.insert(coalesce(executeTimePoint, leeway), std::move(task));
             newTimed(lk);
+#ifdef BDN_DISPATCH_INSTRUMENTATION
+            recordTimedDepth(lk);
+#endif
             notifyWorker(lk);
+
+            return CancellationToken(this, handle.id());
+        }
+
+        /** Calls timer every interval until it returns false. leeway works
+            like for dispatchAsyncDelayed().
+
+            Ticks are due at start + k * interval no matter how long timer
+            takes, so a repeating timer does not drift. */
+        template <class _Rep, class _Period>
+        CancellationToken createTimer(std::chrono::duration<_Rep, _Period> interval, std::function<bool()> timer,
+                                      Clock::duration leeway = Clock::duration::zero())
+        {
+            return createTimer(
+                interval, [timer = std::move(timer)](uint64_t) { return timer(); }, MissedTickPolicy::Coalesce,
+                leeway);
         }
 
+        /** Like createTimer() above, but timer gets the number of ticks that
+            were missed since its previous call, see MissedTickPolicy.
+
+            The main queues of the platforms run timers natively, with the
+            same schedule and policies:
+            - Android posts every tick to the looper at its absolute
+              deadline, computed on the native side and coalesced within
+              leeway like the deadlines of other queues.
+            - macOS and iOS use libdispatch timers, which never run with
+              less than 10 ms leeway. libdispatch coalesces missed ticks on
+              its own. CatchUp then calls timer for each of them back to
+              back, and Skip restarts the libdispatch schedule. */
         template <class _Rep, class _Period>
-        void createTimer(std::chrono::duration<_Rep, _Period> interval, std::function<bool()> timer)
+        CancellationToken createTimer(std::chrono::duration<_Rep, _Period> interval, TickFunction timer,
+                                      MissedTickPolicy policy = MissedTickPolicy::Coalesce,
+                                      Clock::duration leeway = Clock::duration::zero())
         {
             auto intervalInSeconds = std::chrono::duration_cast<std::chrono::duration<double>>(interval);
-            createTimerInternal(intervalInSeconds, timer);
+            return createTimerInternal(intervalInSeconds, std::move(timer), policy, leeway);
         }
 
+        /** Runs function once the queue has nothing else to do: all lanes
+            are empty and no timer or delayed function is due within the
+            next MinIdlePeriod. Idle functions run one after the other in the
+            order they were queued, as long as the idle period lasts.
+
+            If deadlineHint is given and passes before the queue got idle,
+            function is queued like a regular function instead, with
+            IdleDeadline::didTimeout set. */
+        CancellationToken dispatchWhenIdle(IdleFunction function,
+                                           std::optional<Clock::duration> deadlineHint = std::nullopt);
+
       public:
-        void enter()
+        /** Awaitable returned by schedule(). */
+        class ScheduleAwaiter
         {
-            if (_thread) {
-                throw std::logic_error("This queue is already served by its own thread!");
-            }
-            if (_cancelled) {
-                throw std::logic_error("This queue is already cancelled!");
+          public:
+            bool await_ready() const noexcept { return false; }
+
+            template <class CoroutineHandle> void await_suspend(CoroutineHandle handle)
+            {
+                _queue->dispatchAsync([handle]() mutable { handle.resume(); }, _priority);
             }
 
-            _threadId = std::this_thread::get_id();
+            void await_resume() const noexcept {}
 
-            workerThread();
+          private:
+            friend class DispatchQueue;
+            ScheduleAwaiter(DispatchQueue *queue, Priority priority) : _queue(queue), _priority(priority) {}
 
-            LockType lk(_queueMutex);
-            emptyQueues(lk);
-        }
-        void cancel()
-        {
-            LockType lk(_queueMutex);
-            _cancelled = true;
-            notifyWorker(lk);
-        }
-        void executeSync()
-        {
-            if (_thread) {
-                throw std::logic_error("This queue is already served by its own thread!");
-            }
+            DispatchQueue *_queue;
+            Priority _priority;
+        };
 
-            LockType lk(_queueMutex);
-            executeNext(lk);
-        }
+        /** co_await queue.schedule() continues the calling coroutine on this
+            queue. If the queue is cancelled before that happens the coroutine
+            is never resumed. See bdn/Coroutine.h. */
+        ScheduleAwaiter schedule(Priority priority = Priority::Default) { return ScheduleAwaiter(this, priority); }
+
+      public:
+        void enter();
+        void cancel();
+        void executeSync();
+
+      public:
+        WaitMetrics waitMetrics(Priority priority);
+        void resetWaitMetrics();
+
+        /** Limits how long one processing pass may run functions and timers
+            before the queue yields, to the platform's event loop for main
+            queues. A single function that runs longer can still exceed it.
+            Zero disables the limit. */
+        void setProcessBudget(Clock::duration budget);
+        Clock::duration processBudget();
+
+        ProcessMetrics processMetrics();
+        void resetProcessMetrics();
+
+        Statistics statistics();
+
+        /** Clears histograms and counters, maxDepth and maxTimedDepth start
+            over from the current depth. */
+        void resetStatistics();
+
+        /** handler is called on the queue's thread after every function or
+            timer that ran for longer than threshold. Pass nullptr to remove
+            it. Does nothing unless BDN_DISPATCH_INSTRUMENTATION is enabled. */
+        void setSlowTaskHandler(Clock::duration threshold, std::function<void(const SlowTask &)> handler);
 
       protected:
         virtual void notifyWorker(LockType &lk) { _notification.notify_all(); }
         virtual void newTimed(LockType &lk) { _nTimed++; }
-        virtual void createTimerInternal(std::chrono::duration<double> interval, std::function<bool()> timer)
-        {
-            auto delayInNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(interval);
-            dispatchAsyncDelayed(interval, Timer{this, delayInNanoseconds, timer});
-        }
+        virtual CancellationToken createTimerInternal(std::chrono::duration<double> interval, TickFunction timer,
+                                                      MissedTickPolicy policy, Clock::duration leeway);
+
+        /** Cancels a task created by dispatchAsyncDelayed() or the default
+            createTimerInternal(). Subclasses that implement timers on their
+            own override this and hand out ids with PlatformTimerIdFlag set. */
+        virtual bool cancelTimed(uint64_t id);
+
+        /** Blocks the thread serving the queue until new work might have
+            arrived, see notifyWorker(), or until the given time. Called and
+            returns with the queue mutex held. Spurious returns are fine. */
+        virtual void waitForWork(LockType &lk, std::optional<TimePoint> until);
+
+        CancellationToken makeCancellationToken(uint64_t id) { return CancellationToken(this, id); }
+
+        static constexpr uint64_t PlatformTimerIdFlag = uint64_t(1) << 63;
+
+        /** Schedule of repeating timers, for subclasses that run their timers
+            on their own. missedTicks() tells how many ticks a timer that was
+            due at deadline missed if it gets called at called, nextTick()
+            when it is due again after that call. */
+        static uint64_t missedTicks(TimePoint deadline, Clock::duration interval, MissedTickPolicy policy,
+                                    TimePoint called);
+        static TimePoint nextTick(TimePoint deadline, Clock::duration interval, MissedTickPolicy policy,
+                                  TimePoint called, uint64_t missedTicks);
+
+        /** Moves deadline to a point that is shared by many other deadlines
+            and at most leeway later, so that they can share a wakeup. */
+        static TimePoint coalesce(TimePoint deadline, Clock::duration leeway);
+
+      private:
+        static constexpr uint64_t IdleIdFlag = uint64_t(1) << 62;
 
       private:
-        void dispatchAsync(Function function, LockType &lk)
+        static constexpr int SyncSpinCount = 16;
+
+        // Lives on the stack of the thread blocked in dispatchSync(). All
+        // members are written with the queue mutex held.
+        struct SyncWaiter
         {
-            if (_cancelled) {
-                return;
-            }
+            std::condition_variable condition;
+            std::atomic<bool> done{false};
+            SyncWaiter *previous = nullptr;
+            SyncWaiter *next = nullptr;
+        };
 
-            _queue.push(std::move(function));
-            notifyWorker(lk);
-        }
+        void completeSyncWaiter(SyncWaiter &waiter);
+        void waitForSyncWaiter(SyncWaiter &waiter);
 
-        void executeNext(LockType &lk)
+        template <class Result> static Result cancelledSyncResult()
         {
-            if (_queue.empty()) {
-                return;
+            if constexpr (!std::is_void_v<Result>) {
+                throw std::runtime_error("DispatchQueue was cancelled before the function could run");
             }
-
-            auto &next = _queue.front();
-            lk.unlock();
-            (next)();
-            lk.lock();
-            _queue.pop();
         }
 
-        std::optional<TimePoint> processTimed(LockType &lk)
+        struct QueuedTask
         {
-            while (!_timedQueue.empty() && !_cancelled) {
-                auto it = _timedQueue.begin();
-                if (it->first <= Clock::now()) {
-                    while (!it->second.empty() && !_cancelled) {
-                        auto &f = it->second.front();
-                        lk.unlock();
-                        f();
-                        lk.lock();
-                        it->second.pop();
-                    }
-                    _timedQueue.erase(it);
-                } else {
-                    break;
-                }
-            }
-            if (!_timedQueue.empty()) {
-                return _timedQueue.begin()->first;
-            }
+            Function function;
+            TimePoint enqueued;
+#ifdef BDN_DISPATCH_INSTRUMENTATION
+            SourceTag source{};
+#endif
+        };
 
-            return std::nullopt;
+        static QueuedTask makeQueuedTask(Function function, TimePoint enqueued, SourceTag source)
+        {
+#ifdef BDN_DISPATCH_INSTRUMENTATION
+            return QueuedTask{std::move(function), enqueued, source};
+#else
+            return QueuedTask{std::move(function), enqueued};
+#endif
         }
 
-      protected:
-        std::optional<TimePoint> processQueue(LockType &lk)
-        {
-            auto nextTimed = processTimed(lk);
+        using Lane = MPSCQueue<QueuedTask>;
 
-            while (!_queue.empty()) {
-                executeNext(lk);
-                if (nextTimed) {
-                    if (Clock::now() >= *nextTimed)
-                        break;
-                }
-            }
+        Lane &lane(Priority priority) { return _lanes[static_cast<size_t>(priority)]; }
+        bool lanesEmpty() const;
+        size_t queuedCount() const;
 
-            return nextTimed;
-        }
+        bool popNext(QueuedTask &task, TimePoint now, size_t &laneIndex);
+        void runCoalesced(CoalesceKey key);
 
-        std::mutex &queueMutex() { return _queueMutex; }
+        bool executeNext(LockType &lk);
+        std::optional<TimePoint> processTimed(LockType &lk, std::optional<TimePoint> budgetEnd, bool &exhausted);
 
-        void emptyQueues(LockType &lk)
-        {
-            while (!_queue.empty()) {
-                _queue.pop();
-            }
-            _timedQueue.clear();
-        }
+#ifdef BDN_DISPATCH_INSTRUMENTATION
+        void recordDepth();
+        void recordTimedDepth(LockType &lk);
+        void recordRun(LockType &lk, const SlowTask &task);
+#endif
 
-      private:
-        void workerThread()
-        {
-            int oldTimed = -1;
-            LockType lk(_queueMutex);
-            std::optional<TimePoint> nextTimed;
-            while (true) {
-                if (_cancelled) {
-                    return;
-                }
+      protected:
+        std::optional<TimePoint> processQueue(LockType &lk);
 
-                nextTimed = processQueue(lk);
-                oldTimed = _nTimed;
+        std::mutex &queueMutex() { return _queueMutex; }
 
-                if (nextTimed) {
-                    _notification.wait_until(lk, *nextTimed,
-                                             [&]() { return _cancelled || !_queue.empty() || _nTimed != oldTimed; });
-                } else {
-                    _notification.wait(lk, [&]() { return _cancelled || !_queue.empty() || _nTimed != oldTimed; });
-                }
-            }
-        }
+        /** Subclasses that need to be fully constructed before the worker
+            starts waiting pass slave = true to the constructor and call
+            startWorkerThread() themselves. They must call stopWorkerThread()
+            in their destructor then. */
+        void startWorkerThread();
+        void stopWorkerThread();
+
+        void emptyQueues(LockType &lk);
+
+      private:
+        void workerThread();
 
       private:
-        class Timer
+        struct TimedTask
         {
-          public:
-            void operator()()
-            {
-                if (_function()) {
-                    _queue->dispatchAsyncDelayed(_interval, std::move(*this));
-                }
-            }
+            Function function;
+            TickFunction timer;
+            Clock::duration interval{};
+            TimePoint deadline{};
+            Priority priority = Priority::Default;
+            Clock::duration leeway{};
+            MissedTickPolicy policy = MissedTickPolicy::Coalesce;
+#ifdef BDN_DISPATCH_INSTRUMENTATION
+            SourceTag source{};
+#endif
+        };
 
-            DispatchQueue *_queue = nullptr;
-            std::chrono::nanoseconds _interval;
-            std::function<bool()> _function;
+        using TimedQueue = TimingWheel<TimedTask, Clock>;
+
+        struct IdleTask
+        {
+            IdleFunction function;
+            std::optional<TimePoint> deadline;
+            uint64_t id = 0;
         };
 
+        std::optional<TimePoint> queueOverdueIdle(TimePoint now);
+        void processIdle(LockType &lk, std::optional<TimePoint> budgetEnd);
+
+        // Driven by VirtualClock
+        friend class VirtualClock;
+        std::optional<TimePoint> nextDue();
+        void processDue();
+
+
       private:
         std::thread::id _threadId;
         std::unique_ptr<std::thread> _thread;
         const bool _slave;
+        const std::shared_ptr<TimeSource> _timeSource;
 
         std::mutex _queueMutex;
-        std::queue<Function> _queue;
-        std::map<TimePoint, std::queue<Function>> _timedQueue;
+        std::array<Lane, PriorityCount> _lanes;
+        std::array<WaitMetrics, PriorityCount> _waitMetrics;
+        Clock::duration _processBudget = DefaultProcessBudget;
+        ProcessMetrics _processMetrics;
+        TimedQueue _timedQueue;
+        std::unordered_map<CoalesceKey, Function> _coalesced;
+        std::deque<IdleTask> _idleTasks;
+        uint64_t _nextIdleId = 0;
         std::condition_variable _notification;
         int _nTimed = 0;
-        bool _cancelled = false;
+        std::atomic<bool> _cancelled{false};
+
+        int _executing = 0;
+        SyncWaiter *_syncWaiters = nullptr;
+
+#ifdef BDN_DISPATCH_INSTRUMENTATION
+        // Everything but _maxDepth is guarded by _queueMutex. _maxDepth is
+        // updated by producers which otherwise stay lock free.
+        Statistics _statistics;
+        std::atomic<size_t> _maxDepth{0};
+        Clock::duration _slowTaskThreshold{};
+        std::function<void(const SlowTask &)> _slowTaskHandler;
+#endif
     };
 }
@@ -0,0 +1,88 @@
+#pragma once
+
+#if defined(__linux__)
+
+#include <bdn/DispatchQueue.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+namespace bdn
+{
+    /** DispatchQueue that waits in epoll instead of on a condition variable.
+
+        Besides functions and timers the queue can watch file descriptors
+        and call back on its own thread once they become ready, so that I/O
+        shares one loop with everything else and needs no extra thread.
+        Wakeups go through an eventfd, deadlines through a timerfd.
+    */
+    class EpollDispatchQueue : public DispatchQueue
+    {
+      public:
+        /** Conditions passed to watchFd() and reported to FdCallback. */
+        enum FdEvents : uint32_t
+        {
+            Readable = 1u << 0,
+            Writable = 1u << 1,
+            /** Only report transitions to ready, see EPOLLET. Watch only. */
+            EdgeTriggered = 1u << 2,
+            /** Always reported, never needs to be watched. */
+            Error = 1u << 3,
+            HangUp = 1u << 4
+        };
+
+        /** Called on the queue's thread with the conditions that occurred. */
+        using FdCallback = std::function<void(int fd, uint32_t events)>;
+
+      public:
+        /** A slave queue is served by whoever calls enter(), like
+            DispatchQueue(true). Otherwise the queue starts its own thread. */
+        EpollDispatchQueue(bool slave = false, std::shared_ptr<TimeSource> timeSource = nullptr);
+        ~EpollDispatchQueue() override;
+
+      public:
+        /** Calls callback whenever fd is ready for one of events. Replaces
+            an earlier watch of the same fd. The caller keeps owning fd and
+            has to unwatch it before closing it. */
+        void watchFd(int fd, uint32_t events, FdCallback callback);
+
+        /** Returns false if fd was not watched. A callback that is running
+            on another thread right now may still finish, no callback starts
+            afterwards. */
+        bool unwatchFd(int fd);
+
+      protected:
+        void notifyWorker(LockType &lk) override;
+        void waitForWork(LockType &lk, std::optional<TimePoint> until) override;
+
+      private:
+        static constexpr int MaxEventsPerWait = 64;
+        static constexpr uint64_t WakeupTag = UINT64_MAX;
+        static constexpr uint64_t TimerTag = UINT64_MAX - 1;
+
+        struct Watch
+        {
+            uint32_t generation = 0;
+            std::shared_ptr<FdCallback> callback;
+        };
+
+        void armTimer(std::optional<TimePoint> until);
+        void dispatchFd(uint64_t tag, uint32_t epollEvents);
+
+      private:
+        int _epollFd = -1;
+        int _wakeupFd = -1;
+        int _timerFd = -1;
+        std::optional<TimePoint> _armedFor;
+
+        std::mutex _watchMutex;
+        std::unordered_map<int, Watch> _watches;
+        uint32_t _nextGeneration = 1;
+    };
+}
+
+#endif
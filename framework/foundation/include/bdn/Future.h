@@ -0,0 +1,750 @@
+#pragma once
+
+#include <bdn/Task.h>
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace bdn
+{
+    /** Thrown by Future::get() if the future was cancelled. */
+    class FutureCancelled : public std::runtime_error
+    {
+      public:
+        FutureCancelled() : std::runtime_error("The future was cancelled") {}
+    };
+
+    template <class T> class Future;
+    template <class T> class Promise;
+
+    namespace detail
+    {
+        template <class T> struct IsFuture : std::false_type
+        {};
+        template <class T> struct IsFuture<Future<T>> : std::true_type
+        {};
+
+        template <class T> struct UnwrapFuture
+        {
+            using type = T;
+        };
+        template <class T> struct UnwrapFuture<Future<T>>
+        {
+            using type = T;
+        };
+
+        template <class Function, class T> struct ContinuationResult
+        {
+            using type = std::invoke_result_t<Function &, T>;
+        };
+        template <class Function> struct ContinuationResult<Function, void>
+        {
+            using type = std::invoke_result_t<Function &>;
+        };
+
+        // Result of the stage that is currently being produced. Every stage
+        // takes the previous stage's value out before producing its own, so
+        // one buffer serves the whole chain.
+        class ChainValue
+        {
+          public:
+            static constexpr size_t InlineSize = 48;
+
+            ChainValue() = default;
+            ChainValue(const ChainValue &) = delete;
+            ChainValue &operator=(const ChainValue &) = delete;
+            ~ChainValue() { reset(); }
+
+            template <class T> void emplace(T &&value)
+            {
+                using D = std::decay_t<T>;
+                reset();
+                if constexpr (sizeof(D) <= InlineSize && alignof(D) <= alignof(std::max_align_t)) {
+                    _pointer = new (&_buffer) D(std::forward<T>(value));
+                    _destroy = [](void *pointer) { static_cast<D *>(pointer)->~D(); };
+                } else {
+                    _pointer = new D(std::forward<T>(value));
+                    _destroy = [](void *pointer) { delete static_cast<D *>(pointer); };
+                }
+            }
+
+            template <class T> T take()
+            {
+                T value = std::move(*static_cast<T *>(_pointer));
+                reset();
+                return value;
+            }
+
+            void reset()
+            {
+                if (_destroy != nullptr) {
+                    std::exchange(_destroy, nullptr)(_pointer);
+                    _pointer = nullptr;
+                }
+            }
+
+          private:
+            std::aligned_storage_t<InlineSize, alignof(std::max_align_t)> _buffer;
+            void *_pointer = nullptr;
+            void (*_destroy)(void *) = nullptr;
+        };
+
+        enum class ChainStatus
+        {
+            Pending,
+            Value,
+            Error,
+            Cancelled
+        };
+
+        /** Shared by all futures of one then() chain. */
+        class ChainState
+        {
+          public:
+            using Continuation = UniqueFunction<void(const std::shared_ptr<ChainState> &)>;
+
+            struct Slot
+            {
+                uint32_t stage = 0;
+                Continuation continuation;
+            };
+
+          public:
+            std::mutex mutex;
+            std::condition_variable ready;
+
+            uint32_t stage = 0;
+            ChainStatus status = ChainStatus::Pending;
+            bool cancelRequested = false;
+            ChainValue value;
+            std::exception_ptr error;
+
+            // Continuations attached ahead of time, one per stage. Chains are
+            // short, the vector is only used for very long ones.
+            std::array<Slot, 3> slots;
+            std::vector<Slot> moreSlots;
+
+            // Futures this chain waits for (whenAll/whenAny inputs, futures
+            // returned from then()). Cancelling the chain cancels them.
+            std::vector<std::shared_ptr<ChainState>> upstream;
+
+          public:
+            bool isComplete(uint32_t forStage) const { return stage == forStage && status != ChainStatus::Pending; }
+
+            void attach(uint32_t forStage, Continuation continuation, const std::shared_ptr<ChainState> &self)
+            {
+                {
+                    std::unique_lock<std::mutex> lk(mutex);
+                    if (!isComplete(forStage)) {
+                        for (auto &slot : slots) {
+                            if (!slot.continuation) {
+                                slot = Slot{forStage, std::move(continuation)};
+                                return;
+                            }
+                        }
+                        moreSlots.push_back(Slot{forStage, std::move(continuation)});
+                        return;
+                    }
+                }
+                continuation(self);
+            }
+
+            /** Must be called with mutex held. */
+            Continuation takeContinuation(uint32_t forStage)
+            {
+                for (auto &slot : slots) {
+                    if (slot.continuation && slot.stage == forStage) {
+                        return std::move(slot.continuation);
+                    }
+                }
+                for (auto it = moreSlots.begin(); it != moreSlots.end(); ++it) {
+                    if (it->stage == forStage) {
+                        auto continuation = std::move(it->continuation);
+                        moreSlots.erase(it);
+                        return continuation;
+                    }
+                }
+                return nullptr;
+            }
+
+            /** Must be called with mutex held, run the returned continuation
+                after unlocking. */
+            Continuation finish(uint32_t forStage, ChainStatus result)
+            {
+                status = result;
+                ready.notify_all();
+                return takeContinuation(forStage);
+            }
+
+            /** Cancels everything state waits for, but not state itself. */
+            static void cancelUpstream(const std::shared_ptr<ChainState> &state,
+                                       const std::shared_ptr<ChainState> &except = nullptr)
+            {
+                std::vector<std::shared_ptr<ChainState>> inputs;
+                {
+                    std::unique_lock<std::mutex> lk(state->mutex);
+                    inputs = state->upstream;
+                }
+                for (auto &input : inputs) {
+                    if (input != except) {
+                        cancel(input);
+                    }
+                }
+            }
+
+            static void cancel(const std::shared_ptr<ChainState> &state)
+            {
+                std::vector<std::shared_ptr<ChainState>> inputs;
+                {
+                    std::unique_lock<std::mutex> lk(state->mutex);
+                    if (state->cancelRequested) {
+                        return;
+                    }
+                    state->cancelRequested = true;
+                    inputs = state->upstream;
+                }
+                for (auto &input : inputs) {
+                    cancel(input);
+                }
+            }
+
+            template <class T, class... Args>
+            static void complete(const std::shared_ptr<ChainState> &state, uint32_t forStage, Args &&... args)
+            {
+                Continuation next;
+                {
+                    std::unique_lock<std::mutex> lk(state->mutex);
+                    if (state->cancelRequested) {
+                        next = state->finish(forStage, ChainStatus::Cancelled);
+                    } else {
+                        if constexpr (!std::is_void_v<T>) {
+                            state->value.emplace<T>(T(std::forward<Args>(args)...));
+                        }
+                        next = state->finish(forStage, ChainStatus::Value);
+                    }
+                }
+                if (next) {
+                    next(state);
+                }
+            }
+
+            static void fail(const std::shared_ptr<ChainState> &state, uint32_t forStage, std::exception_ptr error)
+            {
+                Continuation next;
+                {
+                    std::unique_lock<std::mutex> lk(state->mutex);
+                    state->error = std::move(error);
+                    next = state->finish(forStage, ChainStatus::Error);
+                }
+                if (next) {
+                    next(state);
+                }
+            }
+
+            static void cancelled(const std::shared_ptr<ChainState> &state, uint32_t forStage)
+            {
+                Continuation next;
+                {
+                    std::unique_lock<std::mutex> lk(state->mutex);
+                    next = state->finish(forStage, ChainStatus::Cancelled);
+                }
+                if (next) {
+                    next(state);
+                }
+            }
+
+            /** Moves the completed result of forStage out and starts the next
+                stage. Returns the previous status. */
+            template <class T, class Storage>
+            static ChainStatus advance(const std::shared_ptr<ChainState> &state, uint32_t forStage, Storage &value,
+                                       std::exception_ptr &error)
+            {
+                std::unique_lock<std::mutex> lk(state->mutex);
+                ChainStatus result = state->status;
+                if (result == ChainStatus::Value) {
+                    if constexpr (!std::is_void_v<T>) {
+                        value.emplace(state->value.take<T>());
+                    }
+                } else if (result == ChainStatus::Error) {
+                    error = std::exchange(state->error, nullptr);
+                }
+                if (state->cancelRequested) {
+                    result = ChainStatus::Cancelled;
+                }
+                state->stage = forStage + 1;
+                state->status = ChainStatus::Pending;
+                return result;
+            }
+        };
+
+        template <class T> using StorageFor = std::conditional_t<std::is_void_v<T>, bool, T>;
+
+        template <class T> struct Optional
+        {
+            std::optional<StorageFor<T>> value;
+            void emplace(StorageFor<T> v) { value.emplace(std::move(v)); }
+        };
+    }
+
+    /** Result of an asynchronous operation.
+
+        Futures are move-only and single-consumer: then() and get() consume
+        the future. All futures created from one future through then() share
+        a single state, so a chain only allocates once. The exceptions are
+        values larger than detail::ChainValue::InlineSize, which allocate
+        once per stage that produces them, and functions whose captures do
+        not fit into a continuation's inline buffer.
+
+        cancel() stops everything in the chain that has not started yet.
+        Functions passed to then() are not called for a cancelled or failed
+        future, the cancellation or exception is passed on to the end of the
+        chain instead.
+    */
+    template <class T> class Future
+    {
+      public:
+        using value_type = T;
+
+      public:
+        Future() = default;
+        Future(Future &&) noexcept = default;
+        Future &operator=(Future &&) noexcept = default;
+        Future(const Future &) = delete;
+        Future &operator=(const Future &) = delete;
+
+      public:
+        bool valid() const { return static_cast<bool>(_state); }
+
+        bool isReady() const
+        {
+            std::unique_lock<std::mutex> lk(_state->mutex);
+            return _state->isComplete(_stage);
+        }
+
+        void cancel() const { detail::ChainState::cancel(_state); }
+
+        void wait() const
+        {
+            std::unique_lock<std::mutex> lk(_state->mutex);
+            _state->ready.wait(lk, [this]() { return _state->isComplete(_stage); });
+        }
+
+        /** Blocks until the result is available. Rethrows the exception of a
+            failed future, throws FutureCancelled if it was cancelled. */
+        T get()
+        {
+            wait();
+
+            auto state = std::move(_state);
+            detail::Optional<T> value;
+            std::exception_ptr error;
+            switch (detail::ChainState::advance<T>(state, _stage, value, error)) {
+            case detail::ChainStatus::Error:
+                std::rethrow_exception(error);
+            case detail::ChainStatus::Cancelled:
+            case detail::ChainStatus::Pending:
+                throw FutureCancelled();
+            case detail::ChainStatus::Value:
+                break;
+            }
+
+            if constexpr (!std::is_void_v<T>) {
+                return std::move(*value.value);
+            }
+        }
+
+        /** Calls function with the result on the thread that completes this
+            future. If function returns a Future the returned future completes
+            with that future's result. */
+        template <class Function> auto then(Function function)
+        {
+            return thenWith([](auto task) { task(); }, std::move(function));
+        }
+
+        /** Like then(function), but function runs on queue. queue is a
+            (smart) pointer to anything with dispatchAsync(Task), e.g. a
+            DispatchQueue or ThreadPool. */
+        template <class QueuePointer, class Function> auto then(QueuePointer queue, Function function)
+        {
+            return thenWith([queue = std::move(queue)](auto task) { queue->dispatchAsync(std::move(task)); },
+                            std::move(function));
+        }
+
+      private:
+        template <class U> friend class Future;
+        template <class U> friend class Promise;
+        template <class U> friend Future<std::vector<U>> whenAll(std::vector<Future<U>> futures);
+        template <class U> friend Future<std::pair<size_t, U>> whenAny(std::vector<Future<U>> futures);
+        template <class Queue, class Function> friend auto async(Queue &&queue, Function function);
+
+        Future(std::shared_ptr<detail::ChainState> state, uint32_t stage) : _state(std::move(state)), _stage(stage) {}
+
+        template <class Function> static auto callWith(Function &function, detail::Optional<T> &value)
+        {
+            if constexpr (std::is_void_v<T>) {
+                return function();
+            } else {
+                return function(std::move(*value.value));
+            }
+        }
+
+        template <class Schedule, class Function> auto thenWith(Schedule schedule, Function function)
+        {
+            using Result = typename detail::ContinuationResult<Function, T>::type;
+            using Next = typename detail::UnwrapFuture<Result>::type;
+
+            uint32_t stage = _stage;
+            auto state = std::move(_state);
+            Future<Next> next(state, stage + 1);
+
+            state->attach(
+                stage,
+                [stage, schedule = std::move(schedule),
+                 function = std::move(function)](const std::shared_ptr<detail::ChainState> &state) mutable {
+                    schedule([stage, state, function = std::move(function)]() mutable {
+                        runStage<Result>(state, stage, function);
+                    });
+                },
+                state);
+
+            return next;
+        }
+
+        template <class Result, class Function>
+        static void runStage(const std::shared_ptr<detail::ChainState> &state, uint32_t stage, Function &function)
+        {
+            detail::Optional<T> value;
+            std::exception_ptr error;
+            switch (detail::ChainState::advance<T>(state, stage, value, error)) {
+            case detail::ChainStatus::Error:
+                detail::ChainState::fail(state, stage + 1, std::move(error));
+                return;
+            case detail::ChainStatus::Cancelled:
+            case detail::ChainStatus::Pending:
+                detail::ChainState::cancelled(state, stage + 1);
+                return;
+            case detail::ChainStatus::Value:
+                break;
+            }
+
+            try {
+                if constexpr (detail::IsFuture<Result>::value) {
+                    Result inner = callWith(function, value);
+                    forward(state, stage + 1, std::move(inner));
+                } else if constexpr (std::is_void_v<Result>) {
+                    callWith(function, value);
+                    detail::ChainState::complete<void>(state, stage + 1);
+                } else {
+                    detail::ChainState::complete<Result>(state, stage + 1, callWith(function, value));
+                }
+            }
+            catch (...) {
+                detail::ChainState::fail(state, stage + 1, std::current_exception());
+            }
+        }
+
+        // Completes stage of state with the result of inner
+        template <class U>
+        static void forward(const std::shared_ptr<detail::ChainState> &state, uint32_t stage, Future<U> inner)
+        {
+            bool cancelled = false;
+            {
+                std::unique_lock<std::mutex> lk(state->mutex);
+                state->upstream.push_back(inner._state);
+                cancelled = state->cancelRequested;
+            }
+            if (cancelled) {
+                inner.cancel();
+            }
+
+            uint32_t innerStage = inner._stage;
+            auto innerState = std::move(inner._state);
+            innerState->attach(
+                innerStage,
+                [state, stage, innerStage](const std::shared_ptr<detail::ChainState> &innerState) {
+                    detail::Optional<U> value;
+                    std::exception_ptr error;
+                    switch (detail::ChainState::advance<U>(innerState, innerStage, value, error)) {
+                    case detail::ChainStatus::Error:
+                        detail::ChainState::fail(state, stage, std::move(error));
+                        break;
+                    case detail::ChainStatus::Cancelled:
+                    case detail::ChainStatus::Pending:
+                        detail::ChainState::cancelled(state, stage);
+                        break;
+                    case detail::ChainStatus::Value:
+                        if constexpr (std::is_void_v<U>) {
+                            detail::ChainState::complete<void>(state, stage);
+                        } else {
+                            detail::ChainState::complete<U>(state, stage, std::move(*value.value));
+                        }
+                        break;
+                    }
+                },
+                innerState);
+        }
+
+      private:
+        std::shared_ptr<detail::ChainState> _state;
+        uint32_t _stage = 0;
+    };
+
+    /** Producer side of a Future. A Promise destroyed without a value
+        cancels its future. */
+    template <class T> class Promise
+    {
+      public:
+        Promise() : _state(std::make_shared<detail::ChainState>()) {}
+        Promise(Promise &&) noexcept = default;
+        Promise &operator=(Promise &&other) noexcept
+        {
+            if (this != &other) {
+                abandon();
+                _state = std::move(other._state);
+                _futureRetrieved = other._futureRetrieved;
+            }
+            return *this;
+        }
+        ~Promise() { abandon(); }
+
+      public:
+        Future<T> future()
+        {
+            if (_futureRetrieved) {
+                throw std::logic_error("Promise::future() may only be called once");
+            }
+            _futureRetrieved = true;
+            return Future<T>(_state, 0);
+        }
+
+        /** True if the future was cancelled, long running producers may check
+            this to stop early. */
+        bool isCancelled() const
+        {
+            std::unique_lock<std::mutex> lk(_state->mutex);
+            return _state->cancelRequested;
+        }
+
+        template <class... Args> void setValue(Args &&... args)
+        {
+            detail::ChainState::complete<T>(release(), 0, std::forward<Args>(args)...);
+        }
+
+        void setException(std::exception_ptr error) { detail::ChainState::fail(release(), 0, std::move(error)); }
+
+      private:
+        std::shared_ptr<detail::ChainState> release()
+        {
+            if (!_state) {
+                throw std::logic_error("Promise was already fulfilled");
+            }
+            return std::move(_state);
+        }
+
+        void abandon()
+        {
+            if (_state) {
+                detail::ChainState::cancelled(std::exchange(_state, nullptr), 0);
+            }
+        }
+
+      private:
+        std::shared_ptr<detail::ChainState> _state;
+        bool _futureRetrieved = false;
+    };
+
+    /** Runs function on queue and returns a future for its result. queue is a
+        (smart) pointer to a DispatchQueue, ThreadPool or anything else with
+        dispatchAsync(Task). function is skipped if the future is cancelled
+        before it started. */
+    template <class Queue, class Function> auto async(Queue &&queue, Function function)
+    {
+        using Result = std::invoke_result_t<Function &>;
+        using Value = typename detail::UnwrapFuture<Result>::type;
+
+        auto state = std::make_shared<detail::ChainState>();
+        Future<Value> future(state, 0);
+
+        queue->dispatchAsync([state, function = std::move(function)]() mutable {
+            bool cancelled = false;
+            {
+                std::unique_lock<std::mutex> lk(state->mutex);
+                cancelled = state->cancelRequested;
+            }
+            if (cancelled) {
+                detail::ChainState::cancelled(state, 0);
+                return;
+            }
+
+            try {
+                if constexpr (detail::IsFuture<Result>::value) {
+                    Future<Value>::forward(state, 0, function());
+                } else if constexpr (std::is_void_v<Result>) {
+                    function();
+                    detail::ChainState::complete<void>(state, 0);
+                } else {
+                    detail::ChainState::complete<Result>(state, 0, function());
+                }
+            }
+            catch (...) {
+                detail::ChainState::fail(state, 0, std::current_exception());
+            }
+        });
+
+        return future;
+    }
+
+    namespace detail
+    {
+        template <class T> struct Join
+        {
+            std::mutex mutex;
+            std::vector<Optional<T>> results;
+            size_t remaining = 0;
+            size_t failed = 0;
+            bool done = false;
+        };
+    }
+
+    /** Completes with all results once every future completed. Fails or is
+        cancelled as soon as one of the futures fails or is cancelled, the
+        others are cancelled then. Cancelling the returned future cancels
+        all inputs. */
+    template <class T> Future<std::vector<T>> whenAll(std::vector<Future<T>> futures)
+    {
+        auto state = std::make_shared<detail::ChainState>();
+        Future<std::vector<T>> result(state, 0);
+
+        if (futures.empty()) {
+            detail::ChainState::complete<std::vector<T>>(state, 0);
+            return result;
+        }
+
+        auto join = std::make_shared<detail::Join<T>>();
+        join->results.resize(futures.size());
+        join->remaining = futures.size();
+        for (auto &future : futures) {
+            state->upstream.push_back(future._state);
+        }
+
+        for (size_t i = 0; i < futures.size(); i++) {
+            uint32_t stage = futures[i]._stage;
+            auto input = std::move(futures[i]._state);
+            input->attach(
+                stage,
+                [state, join, i, stage](const std::shared_ptr<detail::ChainState> &input) {
+                    detail::Optional<T> value;
+                    std::exception_ptr error;
+                    auto status = detail::ChainState::advance<T>(input, stage, value, error);
+
+                    std::unique_lock<std::mutex> lk(join->mutex);
+                    if (join->done) {
+                        return;
+                    }
+                    if (status != detail::ChainStatus::Value) {
+                        join->done = true;
+                        lk.unlock();
+                        detail::ChainState::cancelUpstream(state);
+                        if (status == detail::ChainStatus::Error) {
+                            detail::ChainState::fail(state, 0, std::move(error));
+                        } else {
+                            detail::ChainState::cancelled(state, 0);
+                        }
+                        return;
+                    }
+
+                    join->results[i] = std::move(value);
+                    if (--join->remaining == 0) {
+                        join->done = true;
+                        std::vector<T> values;
+                        values.reserve(join->results.size());
+                        for (auto &result : join->results) {
+                            values.push_back(std::move(*result.value));
+                        }
+                        lk.unlock();
+                        detail::ChainState::complete<std::vector<T>>(state, 0, std::move(values));
+                    }
+                },
+                input);
+        }
+
+        return result;
+    }
+
+    /** Completes with the index and result of the first future that
+        completes successfully and cancels all others. Fails with the last
+        error (or is cancelled) if none of them succeeds. */
+    template <class T> Future<std::pair<size_t, T>> whenAny(std::vector<Future<T>> futures)
+    {
+        auto state = std::make_shared<detail::ChainState>();
+        Future<std::pair<size_t, T>> result(state, 0);
+
+        if (futures.empty()) {
+            detail::ChainState::cancelled(state, 0);
+            return result;
+        }
+
+        auto join = std::make_shared<detail::Join<T>>();
+        join->remaining = futures.size();
+        for (auto &future : futures) {
+            state->upstream.push_back(future._state);
+        }
+
+        for (size_t i = 0; i < futures.size(); i++) {
+            uint32_t stage = futures[i]._stage;
+            auto input = std::move(futures[i]._state);
+            input->attach(
+                stage,
+                [state, join, i, stage](const std::shared_ptr<detail::ChainState> &input) {
+                    detail::Optional<T> value;
+                    std::exception_ptr error;
+                    auto status = detail::ChainState::advance<T>(input, stage, value, error);
+
+                    std::unique_lock<std::mutex> lk(join->mutex);
+                    if (join->done) {
+                        return;
+                    }
+                    join->remaining--;
+
+                    if (status == detail::ChainStatus::Value) {
+                        join->done = true;
+                        lk.unlock();
+                        detail::ChainState::cancelUpstream(state, input);
+                        detail::ChainState::complete<std::pair<size_t, T>>(state, 0, i, std::move(*value.value));
+                        return;
+                    }
+
+                    if (status == detail::ChainStatus::Error) {
+                        join->failed++;
+                        if (join->remaining == 0) {
+                            join->done = true;
+                            lk.unlock();
+                            detail::ChainState::fail(state, 0, std::move(error));
+                        }
+                        return;
+                    }
+
+                    if (join->remaining == 0) {
+                        join->done = true;
+                        lk.unlock();
+                        detail::ChainState::cancelled(state, 0);
+                    }
+                },
+                input);
+        }
+
+        return result;
+    }
+}
@@ -28,9 +28,17 @@ namespace bdn
 
       public:
         GenericApplication(Application::ApplicationControllerFactory appControllerCreator, int argCount, char *args[],
-                           bool commandLineApp)
-            : Application(std::move(appControllerCreator), std::make_shared<DispatchQueue>(true)),
-              _commandLineApp(commandLineApp)
+                           bool commandLineApp, std::shared_ptr<DispatchQueue::TimeSource> timeSource = nullptr)
+            : GenericApplication(std::move(appControllerCreator), argCount, args, commandLineApp,
+                                 std::make_shared<DispatchQueue>(true, std::move(timeSource)))
+        {}
+
+        /** Runs the main loop on mainQueue instead of a plain DispatchQueue,
+            e.g. on an EpollDispatchQueue(true) to watch file descriptors from
+            the main loop. mainQueue has to be a slave queue. */
+        GenericApplication(Application::ApplicationControllerFactory appControllerCreator, int argCount, char *args[],
+                           bool commandLineApp, std::shared_ptr<DispatchQueue> mainQueue)
+            : Application(std::move(appControllerCreator), std::move(mainQueue)), _commandLineApp(commandLineApp)
         {
             makeLaunchInfo(argCount, args);
         }
@@ -39,9 +47,13 @@ namespace bdn
            (see ApplicationController) \param launchInfo application launch
            information \param commandLineApp indicates whether or not the
            application is a commandline app or not (see isCommandLineApp() for
-                more information)*/
-        GenericApplication(Application::ApplicationControllerFactory appControllerCreator, bool commandLineApp)
-            : Application(std::move(appControllerCreator), std::make_shared<DispatchQueue>()),
+                more information)
+            \param timeSource time source of the main queue, e.g. a VirtualClock
+           in tests */
+        GenericApplication(Application::ApplicationControllerFactory appControllerCreator, bool commandLineApp,
+                           std::shared_ptr<DispatchQueue::TimeSource> timeSource = nullptr)
+            : Application(std::move(appControllerCreator),
+                          std::make_shared<DispatchQueue>(false, std::move(timeSource))),
               _commandLineApp(commandLineApp)
         {}
 
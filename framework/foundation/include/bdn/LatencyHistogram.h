@@ -0,0 +1,91 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace bdn
+{
+    /** Fixed size histogram of durations with power of two buckets.
+
+        Bucket 0 counts samples below one microsecond, bucket i samples in
+        [2^(i-1), 2^i) microseconds. The last bucket also takes everything
+        longer than that (~18 minutes). Recording a sample is a handful of
+        instructions and never allocates.
+    */
+    class LatencyHistogram
+    {
+      public:
+        using Duration = std::chrono::nanoseconds;
+
+        static constexpr size_t BucketCount = 32;
+
+      public:
+        void record(Duration duration)
+        {
+            duration = std::max(duration, Duration{});
+
+            _buckets[bucketFor(duration)]++;
+            _count++;
+            _total += duration;
+            _max = std::max(_max, duration);
+        }
+
+        void reset() { *this = LatencyHistogram(); }
+
+        uint64_t count() const { return _count; }
+        Duration total() const { return _total; }
+        Duration max() const { return _max; }
+        Duration mean() const { return _count > 0 ? _total / static_cast<Duration::rep>(_count) : Duration{}; }
+
+        /** Upper bound of the bucket containing the given percentile (0-100)
+            of all samples, capped at max(). */
+        Duration percentile(double percent) const
+        {
+            if (_count == 0) {
+                return Duration{};
+            }
+
+            auto wanted = static_cast<uint64_t>(static_cast<double>(_count) * std::clamp(percent, 0.0, 100.0) / 100.0);
+            wanted = std::clamp<uint64_t>(wanted, 1, _count);
+
+            uint64_t seen = 0;
+            for (size_t i = 0; i < BucketCount; i++) {
+                seen += _buckets[i];
+                if (seen >= wanted) {
+                    return i + 1 < BucketCount ? std::min(bucketUpperBound(i), _max) : _max;
+                }
+            }
+            return _max;
+        }
+
+        const std::array<uint64_t, BucketCount> &buckets() const { return _buckets; }
+
+        /** Exclusive upper bound of bucket index. The last bucket is
+            unbounded. */
+        static Duration bucketUpperBound(size_t index)
+        {
+            return std::chrono::microseconds(uint64_t(1) << std::min(index, BucketCount - 1));
+        }
+
+      private:
+        static size_t bucketFor(Duration duration)
+        {
+            auto micros = static_cast<uint64_t>(duration.count() / 1000);
+            size_t bucket = 0;
+            while (micros != 0 && bucket < BucketCount - 1) {
+                micros >>= 1;
+                bucket++;
+            }
+            return bucket;
+        }
+
+      private:
+        std::array<uint64_t, BucketCount> _buckets{};
+        uint64_t _count = 0;
+        Duration _total{};
+        Duration _max{};
+    };
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace bdn
+{
+    /** Unbounded, lock-free multi-producer/single-consumer FIFO queue.
+
+        Based on Dmitry Vyukov's intrusive MPSC node queue: producers only
+        perform a single atomic exchange on the head, the consumer walks the
+        tail without any atomic read-modify-write operations.
+
+        push() may be called from any number of threads concurrently. pop(),
+        empty() and clear() must only be called by one consumer at a time.
+
+        A producer that has swapped itself into the head but not yet linked its
+        node can make pop() fail temporarily even though size() is not zero.
+        Consumers must treat that as "try again later", not as "empty".
+    */
+    template <class T> class MPSCQueue
+    {
+      private:
+        struct Node
+        {
+            Node() = default;
+            Node(T &&v) : value(std::move(v)) {}
+
+            std::atomic<Node *> next{nullptr};
+            T value;
+        };
+
+      public:
+        MPSCQueue() : _head(&_stub), _tail(&_stub) {}
+        MPSCQueue(const MPSCQueue &) = delete;
+        MPSCQueue &operator=(const MPSCQueue &) = delete;
+
+        ~MPSCQueue() { clear(); }
+
+      public:
+        /** Appends value to the queue. Returns true if the queue was empty
+            before, i.e. if the consumer might have to be woken up. */
+        bool push(T value)
+        {
+            auto node = new Node(std::move(value));
+            pushNode(node);
+            return _size.fetch_add(1, std::memory_order_acq_rel) == 0;
+        }
+
+        /** Removes the oldest element and moves it into value. Returns false if
+            no element could be retrieved. */
+        bool pop(T &value)
+        {
+            Node *node = popNode();
+            if (node == nullptr) {
+                return false;
+            }
+
+            value = std::move(node->value);
+            delete node;
+            _size.fetch_sub(1, std::memory_order_acq_rel);
+            return true;
+        }
+
+        /** Returns a pointer to the oldest element without removing it, or
+            nullptr. Consumer only. */
+        T *front()
+        {
+            Node *tail = _tail;
+            Node *next = tail->next.load(std::memory_order_acquire);
+            if (tail == &_stub) {
+                if (next == nullptr) {
+                    return nullptr;
+                }
+                tail = next;
+            }
+            return &tail->value;
+        }
+
+        bool empty() const { return _size.load(std::memory_order_acquire) <= 0; }
+        std::ptrdiff_t size() const { return std::max<std::ptrdiff_t>(0, _size.load(std::memory_order_acquire)); }
+
+        void clear()
+        {
+            T value;
+            while (pop(value)) {
+            }
+        }
+
+      private:
+        void pushNode(Node *node)
+        {
+            node->next.store(nullptr, std::memory_order_relaxed);
+            Node *prev = _head.exchange(node, std::memory_order_acq_rel);
+            prev->next.store(node, std::memory_order_release);
+        }
+
+        Node *popNode()
+        {
+            Node *tail = _tail;
+            Node *next = tail->next.load(std::memory_order_acquire);
+
+            if (tail == &_stub) {
+                if (next == nullptr) {
+                    return nullptr;
+                }
+                _tail = next;
+                tail = next;
+                next = next->next.load(std::memory_order_acquire);
+            }
+
+            if (next != nullptr) {
+                _tail = next;
+                return tail;
+            }
+
+            if (tail != _head.load(std::memory_order_acquire)) {
+                // A producer is in the middle of linking its node
+                return nullptr;
+            }
+
+            pushNode(&_stub);
+
+            next = tail->next.load(std::memory_order_acquire);
+            if (next != nullptr) {
+                _tail = next;
+                return tail;
+            }
+
+            return nullptr;
+        }
+
+      private:
+        std::atomic<Node *> _head;
+        Node *_tail;
+        Node _stub;
+        std::atomic<std::ptrdiff_t> _size{0};
+    };
+}
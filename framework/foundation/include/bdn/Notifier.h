@@ -1,84 +1,274 @@
 #pragma once
 
+#include <bdn/DispatchQueue.h>
+#include <bdn/Task.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <functional>
-#include <list>
-#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace bdn
 {
-    struct _Subscription
+    /** Handle returned by Notifier::subscribe(). Default constructed handles
+        refer to no subscription. */
+    class NotifierSubscription
     {
       public:
-        size_t order;
-    };
-}
+        NotifierSubscription() = default;
 
-namespace std
-{
-    template <> struct less<std::shared_ptr<bdn::_Subscription>>
-    {
-        bool operator()(const std::shared_ptr<bdn::_Subscription> &k1,
-                        const std::shared_ptr<bdn::_Subscription> &k2) const
+        explicit operator bool() const { return _generation != 0; }
+
+      private:
+        template <class... Arguments> friend class Notifier;
+        template <class... Arguments> friend class ConcurrentNotifier;
+
+        NotifierSubscription(uint32_t index, uint64_t generation) : _index(index), _generation(generation) {}
+
+        // Unique among all notifiers so that handles survive
+        // takeOverSubscriptions() and swap(). ConcurrentNotifier only uses
+        // the generation.
+        static uint64_t nextGeneration()
         {
-            return k1->order < k2->order;
+            static std::atomic<uint64_t> s_generation{0};
+            return s_generation.fetch_add(1, std::memory_order_relaxed) + 1;
         }
+
+        uint32_t _index = 0;
+        uint64_t _generation = 0;
     };
-}
 
-namespace bdn
-{
+    /** How subscriptions on a DispatchQueue deal with notifications that
+        arrive faster than the queue delivers them. */
+    enum class CoalescePolicy
+    {
+        /** Every notification is delivered. */
+        None,
+        /** A notification replaces one that is still waiting on the queue,
+            so only the latest arguments are delivered. */
+        LatestOnly
+    };
+
+    namespace detail
+    {
+        /** How QueuedNotifierTarget keeps an argument until the queue delivers
+            it. Arguments are copied, except for non-const lvalue references:
+            those name objects rather than values, like the Property passed by
+            Property::onChange(), and are delivered as references to the same
+            object. That object has to outlive the subscription. */
+        template <class T> struct QueuedArgument
+        {
+            using type = std::decay_t<T>;
+        };
+        template <class T> struct QueuedArgument<T &>
+        {
+            using type = std::reference_wrapper<T>;
+        };
+        template <class T> struct QueuedArgument<const T &>
+        {
+            using type = T;
+        };
+
+        /** Subscriber that forwards notifications to a DispatchQueue. Queued
+            deliveries are dropped once the subscriber is destroyed, i.e.
+            after it was unsubscribed, and destroying it waits for a delivery
+            that runs on another thread. */
+        template <class... Arguments> class QueuedNotifierTarget
+        {
+          public:
+            using Target = UniqueFunction<void(Arguments...), 32>;
+
+            QueuedNotifierTarget(Target target, const std::shared_ptr<DispatchQueue> &queue, CoalescePolicy policy)
+                : _state(std::make_shared<State>(std::move(target), queue, policy))
+            {}
+            QueuedNotifierTarget(QueuedNotifierTarget &&) noexcept = default;
+            QueuedNotifierTarget &operator=(QueuedNotifierTarget &&) = delete;
+
+            ~QueuedNotifierTarget()
+            {
+                if (!_state) {
+                    return;
+                }
+
+                _state->subscribed = false;
+                // A delivery up the caller's own stack may be the one
+                // unsubscribing; any other one is waited for.
+                if (_state->deliveringOn.load() != std::this_thread::get_id()) {
+                    std::lock_guard<std::mutex> lk(_state->deliveryMutex);
+                }
+            }
+
+            void operator()(Arguments... arguments) const
+            {
+                auto queue = _state->queue.lock();
+                if (!queue) {
+                    return;
+                }
 
+                auto deliver = [state = _state, stored = Stored(std::forward<Arguments>(arguments)...)]() mutable {
+                    std::lock_guard<std::mutex> lk(state->deliveryMutex);
+                    if (!state->subscribed) {
+                        return;
+                    }
+
+                    state->deliveringOn = std::this_thread::get_id();
+                    std::apply([&](auto &... values) { state->target(static_cast<Arguments &&>(values)...); },
+                               stored);
+                    state->deliveringOn = std::thread::id();
+                };
+
+                if (_state->policy == CoalescePolicy::LatestOnly) {
+                    // The state outlives the queued function, so its address
+                    // cannot be reused as a key while the function waits.
+                    queue->dispatchAsyncCoalesced(_state.get(), std::move(deliver));
+                } else {
+                    queue->dispatchAsync(std::move(deliver));
+                }
+            }
+
+          private:
+            using Stored = std::tuple<typename QueuedArgument<Arguments>::type...>;
+
+            struct State
+            {
+                State(Target t, const std::shared_ptr<DispatchQueue> &q, CoalescePolicy p)
+                    : target(std::move(t)), queue(q), policy(p)
+                {}
+
+                Target target;
+                std::weak_ptr<DispatchQueue> queue;
+                CoalescePolicy policy;
+                std::atomic<bool> subscribed{true};
+                std::mutex deliveryMutex;
+                std::atomic<std::thread::id> deliveringOn{std::thread::id()};
+            };
+
+            std::shared_ptr<State> _state;
+        };
+    }
+
+    /** Calls a list of subscribers in the order they subscribed.
+
+        Subscribers live in slots that never move. The first InlineSlots
+        slots are part of the notifier itself, further ones are allocated in
+        chunks of growing size. Slots are chained in subscription order and
+        reused once freed, so subscribe() and unsubscribe() are O(1) and
+        notify() allocates nothing.
+
+        Subscribers may subscribe and unsubscribe while being notified.
+        Subscriptions added during notify() are called in the same run,
+        removed ones are not called anymore. Removed slots are only released
+        once the outermost notify() returns.
+    */
     template <class... Arguments> class Notifier
     {
       public:
-        using Subscription = std::shared_ptr<_Subscription>;
-        using Target = std::function<void(Arguments...)>;
+        using Subscription = NotifierSubscription;
 
-      private:
-        using SubscriptionMap = std::map<Subscription, Target>;
-        using NotificationRun = typename SubscriptionMap::iterator;
+        /** 32 bytes hold a lambda capturing a few pointers or a
+            std::function without allocating, and make a slot 64 bytes. */
+        using Target = UniqueFunction<void(Arguments...), 32>;
+
+        static constexpr uint32_t InlineSlots = 2;
+
+      public:
+        Notifier() = default;
+        Notifier(Notifier &&other) noexcept { swap(other); }
+        Notifier &operator=(Notifier &&other) noexcept
+        {
+            Notifier moved(std::move(other));
+            swap(moved);
+            return *this;
+        }
 
       public:
         Subscription subscribe(Target target)
         {
-            Subscription nextSubscription = createSubscription();
+            auto index = allocate();
+            auto &slot = at(index);
+            slot.target = std::move(target);
+            slot.generation = Subscription::nextGeneration();
+            link(index);
+            return Subscription(index, slot.generation);
+        }
 
-            _subscriptions.insert(_subscriptions.end(), std::make_pair(nextSubscription, target));
-            return nextSubscription;
+        /** Subscribes target to be called on queue instead of the notifying
+            thread. Notifications are delivered asynchronously, even if they
+            happen on queue itself, and are dropped if queue is gone.
+            Deliveries still waiting when the subscription is removed do not
+            happen, and unsubscribe() waits for one that is running on queue
+            unless it is called from that delivery. Arguments are kept as
+            described for detail::QueuedArgument. */
+        Subscription subscribe(Target target, const std::shared_ptr<DispatchQueue> &queue,
+                               CoalescePolicy policy = CoalescePolicy::None)
+        {
+            return subscribe(detail::QueuedNotifierTarget<Arguments...>(std::move(target), queue, policy));
         }
 
+        /** Does nothing if subscription was removed already. */
         void unsubscribe(Subscription subscription)
         {
-            auto it = _subscriptions.find(subscription);
-            if (it != _subscriptions.end()) {
-                for (auto itRunning = _notificationRuns.begin(); itRunning != _notificationRuns.end(); itRunning++) {
-                    if (*itRunning == it) {
-                        (*itRunning)++;
-                    }
+            if (!subscription) {
+                return;
+            }
+
+            if (subscription._index < _capacity && at(subscription._index).generation == subscription._generation) {
+                remove(subscription._index);
+                return;
+            }
+
+            // The subscription was moved here from another notifier
+            for (auto index = _head; index != npos; index = at(index).next) {
+                if (at(index).generation == subscription._generation) {
+                    remove(index);
+                    return;
                 }
-                _subscriptions.erase(it);
             }
         }
 
         void unsubscribeAll()
         {
-            _subscriptions.clear();
-            for (auto itRunning = _notificationRuns.begin(); itRunning != _notificationRuns.end(); itRunning++) {
-                (*itRunning) = _subscriptions.end();
+            for (auto index = _head; index != npos;) {
+                auto next = at(index).next;
+                remove(index);
+                index = next;
             }
         }
 
-        Notifier<Arguments...> operator+=(Target target)
+        Notifier<Arguments...> &operator+=(Target target)
         {
-            subscribe(target);
+            subscribe(std::move(target));
             return *this;
         }
 
-        void swap(Notifier<Arguments...> &other) { std::swap(_subscriptions, other._subscriptions); }
+        bool empty() const { return _live == 0; }
+
+        void swap(Notifier<Arguments...> &other) noexcept
+        {
+            for (uint32_t i = 0; i < InlineSlots; i++) {
+                std::swap(_inline[i], other._inline[i]);
+            }
+            std::swap(_chunks, other._chunks);
+            std::swap(_capacity, other._capacity);
+            std::swap(_used, other._used);
+            std::swap(_head, other._head);
+            std::swap(_tail, other._tail);
+            std::swap(_free, other._free);
+            std::swap(_live, other._live);
+            std::swap(_dead, other._dead);
+            std::swap(_notifying, other._notifying);
+        }
 
         void takeOverSubscriptions(Notifier<Arguments...> &other)
         {
-            if (other._subscriptions.empty()) {
+            if (other.empty()) {
                 return;
             }
 
@@ -87,7 +277,7 @@ namespace bdn
 
         void takeOverSubscriptionsAndNotify(Notifier<Arguments...> &other, Arguments... arguments)
         {
-            if (other._subscriptions.empty()) {
+            if (other.empty()) {
                 return;
             }
 
@@ -96,63 +286,192 @@ namespace bdn
             notifyFrom(firstNew, arguments...);
         }
 
-        typename SubscriptionMap::iterator _takeOverSubscriptions(Notifier<Arguments...> &other)
+      public:
+        void notify(Arguments... arguments)
         {
-            auto otherSubs = other._subscriptions;
-            other.unsubscribeAll();
+            if (_head == npos) {
+                return;
+            }
 
-            auto firstNew = _subscriptions.end();
+            notifyFrom(_head, arguments...);
+        }
 
-            for (auto sub : otherSubs) {
-                sub.first->order = nextId();
-                auto newIt = _subscriptions.insert(_subscriptions.end(), sub);
-                if (firstNew == _subscriptions.end()) {
-                    firstNew = newIt;
+      private:
+        static constexpr uint32_t npos = UINT32_MAX;
+
+        struct Slot
+        {
+            Target target;
+            // 0 while the slot is free or removed during a notification
+            uint64_t generation = 0;
+            uint32_t next = npos;
+            uint32_t previous = npos;
+        };
+
+        struct NotifyingScope
+        {
+            explicit NotifyingScope(Notifier &notifier) : _notifier(notifier) { _notifier._notifying++; }
+            ~NotifyingScope()
+            {
+                if (--_notifier._notifying == 0 && _notifier._dead > 0) {
+                    _notifier.releaseDead();
                 }
             }
 
-            return firstNew;
+            Notifier &_notifier;
+        };
+
+        void notifyFrom(uint32_t first, Arguments... arguments)
+        {
+            NotifyingScope scope(*this);
+
+            // Slots never move and removed ones stay chained until the scope
+            // ends, so following next is safe whatever the targets do.
+            for (auto index = first; index != npos; index = at(index).next) {
+                auto &slot = at(index);
+                if (slot.generation != 0) {
+                    slot.target(arguments...);
+                }
+            }
         }
 
-      public:
-        void notify(Arguments... arguments)
+        uint32_t _takeOverSubscriptions(Notifier<Arguments...> &other)
         {
-            if (_subscriptions.empty()) {
-                return;
+            auto firstNew = npos;
+            for (auto index = other._head; index != npos; index = other.at(index).next) {
+                auto &slot = other.at(index);
+                if (slot.generation == 0) {
+                    continue;
+                }
+
+                auto newIndex = allocate();
+                auto &newSlot = at(newIndex);
+                newSlot.target = std::move(slot.target);
+                newSlot.generation = slot.generation;
+                link(newIndex);
+
+                if (firstNew == npos) {
+                    firstNew = newIndex;
+                }
             }
+            other.unsubscribeAll();
 
-            notifyFrom(_subscriptions.begin(), arguments...);
+            return firstNew;
         }
 
       private:
-        void notifyFrom(typename SubscriptionMap::iterator itStart, Arguments... arguments)
+        // Chunk c holds InlineSlots << c slots, so the first index in it is
+        // InlineSlots * (2^c - 1).
+        Slot &at(uint32_t index)
         {
-            auto itRun = _notificationRuns.insert(_notificationRuns.end(), itStart);
+            if (index < InlineSlots) {
+                return _inline[index];
+            }
 
-            auto &notificationRun = *itRun;
-            auto it = notificationRun;
-            do {
-                notificationRun++;
-                it->second(arguments...);
-                it = notificationRun;
-            } while (it != _subscriptions.end());
+            uint32_t scaled = index / InlineSlots + 1;
+            uint32_t chunk = 0;
+            while ((scaled >> (chunk + 1)) != 0) {
+                chunk++;
+            }
+            uint32_t first = InlineSlots * ((1u << chunk) - 1);
+            return _chunks[chunk - 1][index - first];
+        }
+
+        uint32_t allocate()
+        {
+            if (_free != npos) {
+                auto index = _free;
+                _free = at(index).next;
+                return index;
+            }
 
-            _notificationRuns.erase(itRun);
+            if (_used == _capacity) {
+                auto chunkSize = InlineSlots << (_chunks.size() + 1);
+                _chunks.push_back(std::make_unique<Slot[]>(chunkSize));
+                _capacity += chunkSize;
+            }
+            return _used++;
         }
 
-      private:
-        size_t nextId()
+        void link(uint32_t index)
         {
-            if (!_subscriptions.empty()) {
-                return _subscriptions.rbegin()->first->order + 1;
+            auto &slot = at(index);
+            slot.previous = _tail;
+            slot.next = npos;
+            if (_tail != npos) {
+                at(_tail).next = index;
+            } else {
+                _head = index;
             }
-            return 0;
+            _tail = index;
+            _live++;
         }
 
-        Subscription createSubscription() { return std::make_shared<_Subscription>(_Subscription{nextId()}); }
+        void remove(uint32_t index)
+        {
+            auto &slot = at(index);
+            if (slot.generation == 0) {
+                return;
+            }
+
+            slot.generation = 0;
+            _live--;
+
+            if (_notifying > 0) {
+                // The target may be running right now. It is destroyed once
+                // the notification is over.
+                _dead++;
+                return;
+            }
+
+            release(index);
+        }
+
+        void release(uint32_t index)
+        {
+            auto &slot = at(index);
+            slot.target = nullptr;
+
+            if (slot.previous != npos) {
+                at(slot.previous).next = slot.next;
+            } else {
+                _head = slot.next;
+            }
+            if (slot.next != npos) {
+                at(slot.next).previous = slot.previous;
+            } else {
+                _tail = slot.previous;
+            }
+
+            slot.previous = npos;
+            slot.next = _free;
+            _free = index;
+        }
+
+        void releaseDead()
+        {
+            for (auto index = _head; index != npos;) {
+                auto next = at(index).next;
+                if (at(index).generation == 0) {
+                    release(index);
+                    _dead--;
+                }
+                index = next;
+            }
+        }
 
       private:
-        SubscriptionMap _subscriptions;
-        std::list<NotificationRun> _notificationRuns;
+        std::array<Slot, InlineSlots> _inline;
+        std::vector<std::unique_ptr<Slot[]>> _chunks;
+        uint32_t _capacity = InlineSlots;
+        uint32_t _used = 0;
+
+        uint32_t _head = npos;
+        uint32_t _tail = npos;
+        uint32_t _free = npos;
+
+        uint32_t _live = 0;
+        uint32_t _dead = 0;
+        uint32_t _notifying = 0;
     };
 }
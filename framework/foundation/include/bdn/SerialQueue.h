@@ -0,0 +1,118 @@
+#pragma once
+
+#include <bdn/MPSCQueue.h>
+#include <bdn/Task.h>
+#include <bdn/ThreadPool.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace bdn
+{
+    /** Runs functions one after the other in the order they were queued,
+        like a DispatchQueue, but without a thread of its own.
+
+        While functions are pending the queue occupies one job on its
+        ThreadPool, which runs up to batchSize functions back to back before
+        it yields the worker to other jobs. An empty queue costs nothing but
+        its own memory, so there can be one queue per subsystem.
+
+        Functions may run on different workers, but never concurrently. Must
+        be owned by a std::shared_ptr; pending functions keep the queue alive.
+    */
+    class SerialQueue : public std::enable_shared_from_this<SerialQueue>
+    {
+      public:
+        using Function = Task;
+
+        static constexpr size_t DefaultBatchSize = 32;
+
+      public:
+        /** Uses Application::threadPool() if pool is nullptr. */
+        explicit SerialQueue(std::shared_ptr<ThreadPool> pool = nullptr, size_t batchSize = DefaultBatchSize);
+        SerialQueue(const SerialQueue &) = delete;
+        SerialQueue &operator=(const SerialQueue &) = delete;
+
+      public:
+        std::shared_ptr<ThreadPool> pool() const { return _pool; }
+
+        /** Returns true if called from a function running on this queue. */
+        bool isCurrent() const;
+
+        void dispatchAsync(Function function);
+
+        /** Runs function on the queue and blocks until it has finished,
+            returning its result. Exceptions are rethrown in the calling
+            thread. Called from the queue itself function runs right away.
+
+            Blocks a worker if called from the pool, so that calling it from
+            every worker of the pool at once deadlocks.
+        */
+        template <class F> auto dispatchSync(F &&function) -> std::invoke_result_t<F &>
+        {
+            using Result = std::invoke_result_t<F &>;
+            static_assert(!std::is_reference_v<Result>, "dispatchSync() cannot return references");
+
+            if (isCurrent()) {
+                return function();
+            }
+
+            using Storage = std::conditional_t<std::is_void_v<Result>, bool, Result>;
+            std::optional<Storage> result;
+            std::exception_ptr error;
+            std::mutex mutex;
+            std::condition_variable condition;
+            bool done = false;
+
+            dispatchAsync([&]() {
+                try {
+                    if constexpr (std::is_void_v<Result>) {
+                        function();
+                        result.emplace(true);
+                    } else {
+                        result.emplace(function());
+                    }
+                }
+                catch (...) {
+                    error = std::current_exception();
+                }
+
+                std::unique_lock<std::mutex> lk(mutex);
+                done = true;
+                condition.notify_one();
+            });
+
+            std::unique_lock<std::mutex> lk(mutex);
+            condition.wait(lk, [&]() { return done; });
+
+            if (error) {
+                std::rethrow_exception(error);
+            }
+            if constexpr (!std::is_void_v<Result>) {
+                return std::move(*result);
+            }
+        }
+
+      private:
+        void drain();
+
+      private:
+        std::shared_ptr<ThreadPool> _pool;
+        const size_t _batchSize;
+
+        MPSCQueue<Function> _functions;
+
+        // Functions queued but not run yet. The producer that raises it from
+        // zero schedules the drain job, the drain job only ends once it
+        // brought it back to zero, so there is never more than one.
+        std::atomic<size_t> _pending{0};
+    };
+}
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace bdn
+{
+    template <class Signature, size_t InlineSize = 48> class UniqueFunction;
+
+    /** Move-only replacement for std::function with an inline buffer of
+        InlineSize bytes.
+
+        Callables that fit into the buffer and are nothrow move constructible
+        are stored in place, everything else is put on the heap. Unlike
+        std::function it accepts move-only callables, e.g. lambdas capturing a
+        std::unique_ptr or std::promise.
+
+        Calling an empty UniqueFunction throws std::bad_function_call.
+    */
+    template <class R, class... Args, size_t InlineSize> class UniqueFunction<R(Args...), InlineSize>
+    {
+      private:
+        using Storage = std::aligned_storage_t<InlineSize, alignof(std::max_align_t)>;
+
+        struct VTable
+        {
+            R (*invoke)(void *target, Args &&... args);
+            void (*move)(void *to, void *from) noexcept;
+            void (*destroy)(void *target) noexcept;
+        };
+
+        template <class F>
+        static constexpr bool fitsInline = sizeof(F) <= sizeof(Storage) && alignof(F) <= alignof(Storage) &&
+                                           std::is_nothrow_move_constructible_v<F>;
+
+        template <class F> struct InlineTarget
+        {
+            static F &get(void *target) { return *std::launder(static_cast<F *>(target)); }
+
+            static R invoke(void *target, Args &&... args) { return get(target)(std::forward<Args>(args)...); }
+            static void move(void *to, void *from) noexcept
+            {
+                new (to) F(std::move(get(from)));
+                get(from).~F();
+            }
+            static void destroy(void *target) noexcept { get(target).~F(); }
+
+            static constexpr VTable vtable{&invoke, &move, &destroy};
+        };
+
+        template <class F> struct HeapTarget
+        {
+            static F *&get(void *target) { return *std::launder(static_cast<F **>(target)); }
+
+            static R invoke(void *target, Args &&... args) { return (*get(target))(std::forward<Args>(args)...); }
+            static void move(void *to, void *from) noexcept { new (to) F *(get(from)); }
+            static void destroy(void *target) noexcept { delete get(target); }
+
+            static constexpr VTable vtable{&invoke, &move, &destroy};
+        };
+
+        template <class F> static bool isNull(const F &function)
+        {
+            if constexpr (std::is_pointer_v<F> || std::is_member_pointer_v<F>) {
+                return function == nullptr;
+            } else {
+                return false;
+            }
+        }
+
+        template <class Fn, class... FnArgs> static bool isNull(const std::function<Fn(FnArgs...)> &function)
+        {
+            return !function;
+        }
+
+        template <class F> static bool isNull(const UniqueFunction<F, InlineSize> &function) { return !function; }
+
+      public:
+        UniqueFunction() noexcept = default;
+        UniqueFunction(std::nullptr_t) noexcept {}
+
+        template <class F, class D = std::decay_t<F>,
+                  class = std::enable_if_t<!std::is_same_v<D, UniqueFunction> &&
+                                           std::is_invocable_r_v<R, D &, Args...>>>
+        UniqueFunction(F &&function)
+        {
+            if (isNull(function)) {
+                return;
+            }
+
+            if constexpr (fitsInline<D>) {
+                new (&_storage) D(std::forward<F>(function));
+                _vtable = &InlineTarget<D>::vtable;
+            } else {
+                new (&_storage) D *(new D(std::forward<F>(function)));
+                _vtable = &HeapTarget<D>::vtable;
+            }
+        }
+
+        UniqueFunction(UniqueFunction &&other) noexcept { moveFrom(other); }
+
+        UniqueFunction &operator=(UniqueFunction &&other) noexcept
+        {
+            if (this != &other) {
+                reset();
+                moveFrom(other);
+            }
+            return *this;
+        }
+
+        UniqueFunction &operator=(std::nullptr_t) noexcept
+        {
+            reset();
+            return *this;
+        }
+
+        template <class F, class D = std::decay_t<F>,
+                  class = std::enable_if_t<!std::is_same_v<D, UniqueFunction> &&
+                                           std::is_invocable_r_v<R, D &, Args...>>>
+        UniqueFunction &operator=(F &&function)
+        {
+            return *this = UniqueFunction(std::forward<F>(function));
+        }
+
+        UniqueFunction(const UniqueFunction &) = delete;
+        UniqueFunction &operator=(const UniqueFunction &) = delete;
+
+        ~UniqueFunction() { reset(); }
+
+      public:
+        R operator()(Args... args) const
+        {
+            if (_vtable == nullptr) {
+                throw std::bad_function_call();
+            }
+            return _vtable->invoke(const_cast<Storage *>(&_storage), std::forward<Args>(args)...);
+        }
+
+        explicit operator bool() const noexcept { return _vtable != nullptr; }
+
+        void swap(UniqueFunction &other) noexcept
+        {
+            UniqueFunction temp(std::move(other));
+            other = std::move(*this);
+            *this = std::move(temp);
+        }
+
+      private:
+        void reset() noexcept
+        {
+            if (_vtable != nullptr) {
+                _vtable->destroy(&_storage);
+                _vtable = nullptr;
+            }
+        }
+
+        void moveFrom(UniqueFunction &other) noexcept
+        {
+            if (other._vtable != nullptr) {
+                other._vtable->move(&_storage, &other._storage);
+                _vtable = std::exchange(other._vtable, nullptr);
+            }
+        }
+
+      private:
+        Storage _storage;
+        const VTable *_vtable = nullptr;
+    };
+
+    template <class Signature, size_t InlineSize>
+    bool operator==(const UniqueFunction<Signature, InlineSize> &function, std::nullptr_t) noexcept
+    {
+        return !function;
+    }
+
+    template <class Signature, size_t InlineSize>
+    bool operator!=(const UniqueFunction<Signature, InlineSize> &function, std::nullptr_t) noexcept
+    {
+        return static_cast<bool>(function);
+    }
+
+    /** Type of the functions queued in DispatchQueue and ThreadPool. 48 bytes
+        hold a lambda capturing a couple of shared_ptrs without allocating. */
+    using Task = UniqueFunction<void(), 48>;
+}
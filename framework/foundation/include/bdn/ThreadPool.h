@@ -0,0 +1,155 @@
+#pragma once
+
+#include <bdn/DispatchQueue.h>
+#include <bdn/Task.h>
+#include <bdn/WorkStealingDeque.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace bdn
+{
+    /** Runs functions concurrently on a fixed set of worker threads.
+
+        Every worker owns a WorkStealingDeque. Functions dispatched from a
+        worker go to its own deque and are run newest first, functions
+        dispatched from other threads go to a shared injection queue. Idle
+        workers steal the oldest functions from their siblings.
+
+        Unlike DispatchQueue there are no ordering guarantees between
+        functions. Functions that have not started when the pool is destroyed
+        are discarded.
+
+        Application::threadPool() returns a pool shared by the whole app whose
+        completions run on the main queue.
+    */
+    class ThreadPool
+    {
+      public:
+        using Function = Task;
+
+      public:
+        /** threadCount 0 means std::thread::hardware_concurrency(). Completions
+            of dispatchAsync(work, completion) run on completionQueue unless
+            another queue is passed explicitly. */
+        explicit ThreadPool(size_t threadCount = 0, std::shared_ptr<DispatchQueue> completionQueue = nullptr);
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+        ~ThreadPool();
+
+      public:
+        size_t threadCount() const { return _workers.size(); }
+
+        /** Returns true if called from one of this pool's workers. */
+        bool isWorkerThread() const;
+
+        void dispatchAsync(Function function);
+
+        /** Runs work on the pool and then calls completion with its result
+            (or without arguments if work returns void) on completionQueue.
+
+            If no queue is given the pool's default completion queue is used.
+            If that queue no longer exists the completion is dropped.
+        */
+        template <class Work, class Completion>
+        void dispatchAsync(Work work, Completion completion, std::shared_ptr<DispatchQueue> completionQueue = nullptr)
+        {
+            std::weak_ptr<DispatchQueue> weakQueue = completionQueue ? completionQueue : _completionQueue;
+
+            dispatchAsync([work = std::move(work), completion = std::move(completion), weakQueue]() mutable {
+                using Result = std::invoke_result_t<Work &>;
+
+                if constexpr (std::is_void_v<Result>) {
+                    work();
+                    if (auto queue = weakQueue.lock()) {
+                        queue->dispatchAsync(std::move(completion));
+                    }
+                } else {
+                    Result result = work();
+                    if (auto queue = weakQueue.lock()) {
+                        queue->dispatchAsync(
+                            [completion = std::move(completion), result = std::move(result)]() mutable {
+                                completion(std::move(result));
+                            });
+                    }
+                }
+            });
+        }
+
+        /** Calls body(i) for every i in [begin, end) and returns when all
+            calls have finished.
+
+            The range is split into chunks of grainSize indices (chosen
+            automatically if 0) which the pool's workers and the calling
+            thread process concurrently. If body throws no further chunks are
+            started and the first exception is rethrown here.
+
+            May be called from a worker. The calling thread only runs chunks of
+            this call, never other functions of the pool, and runs all chunks
+            itself if the pool is stopping.
+        */
+        template <class Index, class Body> void parallelFor(Index begin, Index end, Body &&body, Index grainSize = 0)
+        {
+            static_assert(std::is_integral_v<Index>, "parallelFor() requires an integral index type");
+
+            if (end <= begin) {
+                return;
+            }
+
+            auto count = static_cast<size_t>(end - begin);
+            size_t grain = grainSize > 0 ? static_cast<size_t>(grainSize)
+                                         : std::max<size_t>(1, count / (std::max<size_t>(1, threadCount()) * 4));
+            size_t chunkCount = (count + grain - 1) / grain;
+
+            runChunks(chunkCount, [&](size_t chunk) {
+                Index first = begin + static_cast<Index>(chunk * grain);
+                Index last = (chunk + 1) * grain >= count ? end : begin + static_cast<Index>((chunk + 1) * grain);
+                for (Index i = first; i < last; i++) {
+                    body(i);
+                }
+            });
+        }
+
+      private:
+        struct Job
+        {
+            Function function;
+        };
+
+        struct Worker
+        {
+            WorkStealingDeque<Job *> deque;
+            std::thread thread;
+        };
+
+        Worker *currentWorker() const;
+
+        void runChunks(size_t chunkCount, const std::function<void(size_t)> &chunk);
+
+        Job *findJob(Worker *self);
+        void run(Job *job);
+        void workerThread(size_t index);
+
+      private:
+        std::vector<std::unique_ptr<Worker>> _workers;
+        std::weak_ptr<DispatchQueue> _completionQueue;
+
+        std::mutex _mutex;
+        std::condition_variable _wakeup;
+        std::deque<Job *> _injected;
+
+        std::atomic<size_t> _pending{0};
+        std::atomic<size_t> _sleeping{0};
+        std::atomic<bool> _stopped{false};
+    };
+}
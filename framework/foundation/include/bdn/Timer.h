@@ -24,6 +24,10 @@ namespace bdn
 
       public:
         Property<Duration> interval{Duration(0.0)};
+
+        /** How much later than interval the timer may fire. Timers on the
+            same queue whose windows overlap are fired in one wakeup. */
+        Property<Duration> tolerance{Duration(0.0)};
         Property<bool> repeat = false;
         Property<bool> running = false;
 
@@ -41,6 +45,7 @@ namespace bdn
       private:
         size_t _id = 0;
         std::shared_ptr<DispatchQueue> _dispatchQueue;
+        DispatchQueue::CancellationToken _scheduled;
         Notifier<> _triggered;
         std::shared_ptr<TimerImpl> _impl;
         bool _isRunning = false;
@@ -0,0 +1,505 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace bdn
+{
+    /** Hierarchical timing wheel used by DispatchQueue to store delayed work.
+
+        Entries are kept in a pooled vector and linked into one of
+        Levels x 64 slots. Level 0 has a resolution of one tick (1ms by
+        default), every further level covers 64 times the range of the level
+        below it. Entries in higher levels are cascaded down once the wheel
+        reaches the start of their slot.
+
+        Insertion and cancellation are O(1), finding the next deadline is
+        O(Levels) using per level occupancy bitmasks. Entries become due in
+        deadline order, entries with identical deadlines in insertion order.
+
+        Every entry is identified by a generation counted Handle. Handle ids
+        never have their top two bits set, users may use them to tag their own ids. An expired
+        entry stays allocated until the caller either finish()es it or
+        reschedule()s it, so repeating work keeps its handle and can still be
+        cancelled while it runs.
+
+        The wheel is not thread safe, DispatchQueue protects it with its queue
+        mutex.
+    */
+    template <class T, class Clock = std::chrono::steady_clock> class TimingWheel
+    {
+      public:
+        using TimePoint = typename Clock::time_point;
+        using Duration = typename Clock::duration;
+
+      private:
+        static constexpr int Levels = 6;
+        static constexpr int SlotBits = 6;
+        static constexpr int SlotsPerLevel = 1 << SlotBits;
+        static constexpr uint64_t SlotMask = SlotsPerLevel - 1;
+
+        static constexpr uint32_t npos = UINT32_MAX;
+        static constexpr uint32_t GenerationMask = UINT32_MAX >> 2;
+        static constexpr int FreeList = -1;
+        static constexpr int ExpiredList = Levels * SlotsPerLevel;
+        static constexpr int Running = ExpiredList + 1;
+        static constexpr int RunningCancelled = ExpiredList + 2;
+
+        struct Entry
+        {
+            TimePoint deadline;
+            uint64_t tick = 0;
+            uint64_t sequence = 0;
+            uint32_t prev = npos;
+            uint32_t next = npos;
+            uint32_t generation = 0;
+            int list = FreeList;
+            std::optional<T> value;
+        };
+
+        struct List
+        {
+            uint32_t head = npos;
+            uint32_t tail = npos;
+        };
+
+      public:
+        class Handle
+        {
+          public:
+            Handle() = default;
+
+            uint64_t id() const { return (uint64_t(_generation) << 32) | _index; }
+            static Handle fromId(uint64_t id)
+            {
+                return Handle(static_cast<uint32_t>(id & UINT32_MAX), static_cast<uint32_t>(id >> 32));
+            }
+
+            explicit operator bool() const { return _index != npos; }
+
+          private:
+            friend class TimingWheel;
+            Handle(uint32_t index, uint32_t generation) : _index(index), _generation(generation) {}
+
+            uint32_t _index = npos;
+            uint32_t _generation = 0;
+        };
+
+      public:
+        TimingWheel(TimePoint origin, Duration resolution = std::chrono::milliseconds(1))
+            : _origin(origin), _resolution(resolution)
+        {}
+
+      public:
+        Handle insert(TimePoint deadline, T value)
+        {
+            uint32_t index = allocate();
+            schedule(index, deadline, std::move(value));
+            _size++;
+            return Handle(index, _entries[index].generation);
+        }
+
+        /** Removes a pending entry. If the entry is currently running it is
+            flagged so that a following reschedule() fails. Returns false if
+            the handle does not refer to a live entry (anymore). */
+        bool cancel(Handle handle)
+        {
+            Entry *entry = lookup(handle);
+            if (entry == nullptr || entry->list == RunningCancelled) {
+                return false;
+            }
+
+            if (entry->list == Running) {
+                entry->list = RunningCancelled;
+                return true;
+            }
+
+            unlink(handle._index);
+            release(handle._index);
+            return true;
+        }
+
+        /** Puts an entry returned by popExpired() back into the wheel. Fails
+            and releases the entry if it was cancelled in the meantime. */
+        bool reschedule(Handle handle, TimePoint deadline, T value)
+        {
+            Entry *entry = lookup(handle);
+            if (entry == nullptr || (entry->list != Running && entry->list != RunningCancelled)) {
+                return false;
+            }
+
+            if (entry->list == RunningCancelled) {
+                release(handle._index);
+                return false;
+            }
+
+            schedule(handle._index, deadline, std::move(value));
+            return true;
+        }
+
+        /** Releases an entry returned by popExpired(). */
+        void finish(Handle handle)
+        {
+            Entry *entry = lookup(handle);
+            if (entry != nullptr && (entry->list == Running || entry->list == RunningCancelled)) {
+                release(handle._index);
+            }
+        }
+
+        /** Returns the point in time at which the caller should call
+            popExpired() next. This is exact for entries due within the next
+            64 ticks and the start of the next cascade otherwise. */
+        std::optional<TimePoint> nextDeadline() const
+        {
+            if (_expired.head != npos) {
+                return _entries[_expired.head].deadline;
+            }
+
+            auto next = nextEvent();
+            if (!next) {
+                return std::nullopt;
+            }
+
+            if (next->level == 0) {
+                const List &slot = _slots[slotIndex(0, next->tick)];
+                // Everything in a level 0 slot is due within that tick
+                TimePoint earliest = toTimePoint(next->tick + 1);
+                for (uint32_t i = slot.head; i != npos; i = _entries[i].next) {
+                    earliest = std::min(earliest, _entries[i].deadline);
+                }
+                return earliest;
+            }
+
+            return toTimePoint(next->tick);
+        }
+
+        /** Moves the next entry whose deadline is not later than now into
+            value and marks it as running. The returned handle must be passed
+            to finish() or reschedule() afterwards. */
+        std::optional<Handle> popExpired(TimePoint now, T &value)
+        {
+            if (_expired.head == npos) {
+                collect(now);
+            }
+
+            uint32_t index = _expired.head;
+            if (index == npos) {
+                return std::nullopt;
+            }
+
+            unlink(index);
+
+            Entry &entry = _entries[index];
+            entry.list = Running;
+            value = std::move(*entry.value);
+            entry.value.reset();
+
+            return Handle(index, entry.generation);
+        }
+
+        bool empty() const { return _size == 0; }
+        size_t size() const { return _size; }
+
+        void clear()
+        {
+            // Entries are released instead of dropped so that outstanding
+            // handles can never match a reused entry.
+            for (uint32_t index = 0; index < _entries.size(); index++) {
+                if (_entries[index].list != FreeList) {
+                    release(index);
+                }
+            }
+            _slots.fill(List{});
+            _occupied.fill(0);
+            _expired = List{};
+        }
+
+      private:
+        struct Event
+        {
+            uint64_t tick;
+            int level;
+        };
+
+        Entry *lookup(Handle handle)
+        {
+            if (handle._index >= _entries.size()) {
+                return nullptr;
+            }
+            Entry &entry = _entries[handle._index];
+            if (entry.generation != handle._generation || entry.list == FreeList) {
+                return nullptr;
+            }
+            return &entry;
+        }
+
+        void schedule(uint32_t index, TimePoint deadline, T &&value)
+        {
+            Entry &entry = _entries[index];
+            entry.deadline = deadline;
+            entry.tick = std::max(toTick(deadline), _currentTick);
+            entry.sequence = _nextSequence++;
+            entry.value.emplace(std::move(value));
+
+            place(index);
+        }
+
+        uint64_t toTick(TimePoint timePoint) const
+        {
+            if (timePoint <= _origin) {
+                return 0;
+            }
+            return static_cast<uint64_t>((timePoint - _origin) / _resolution);
+        }
+
+        TimePoint toTimePoint(uint64_t tick) const { return _origin + _resolution * static_cast<int64_t>(tick); }
+
+        static size_t slotIndex(int level, uint64_t tick)
+        {
+            return static_cast<size_t>(level) * SlotsPerLevel + ((tick >> (level * SlotBits)) & SlotMask);
+        }
+
+        // Returns the tick at which the next slot has to be processed and the
+        // level it lives in. Slots of higher levels start after all slots of
+        // lower levels, except for a cascade that is pending at _currentTick.
+        std::optional<Event> nextEvent() const
+        {
+            std::optional<Event> best;
+
+            for (int level = 0; level < Levels; level++) {
+                int shift = level * SlotBits;
+                uint64_t digit = (_currentTick >> shift) & SlotMask;
+                bool atSlotStart = (_currentTick & ((uint64_t(1) << shift) - 1)) == 0;
+
+                uint64_t first = atSlotStart ? digit : digit + 1;
+                if (first >= SlotsPerLevel) {
+                    continue;
+                }
+
+                uint64_t mask = _occupied[level] & (~uint64_t(0) << first);
+                if (mask == 0) {
+                    continue;
+                }
+
+                uint64_t slot = static_cast<uint64_t>(countTrailingZeros(mask));
+                uint64_t windowStart = (_currentTick >> (shift + SlotBits)) << (shift + SlotBits);
+                uint64_t tick = windowStart | (slot << shift);
+
+                if (!best || tick <= best->tick) {
+                    best = Event{tick, level};
+                }
+            }
+
+            return best;
+        }
+
+        void collect(TimePoint now)
+        {
+            uint64_t nowTick = toTick(now);
+
+            while (true) {
+                auto next = nextEvent();
+                if (!next || next->tick > nowTick) {
+                    break;
+                }
+
+                _currentTick = next->tick;
+                cascade();
+
+                bool partial = _currentTick == nowTick;
+                expireSlot(now, partial);
+
+                if (partial) {
+                    break;
+                }
+                _currentTick++;
+            }
+        }
+
+        void cascade()
+        {
+            for (int level = Levels - 1; level > 0; level--) {
+                int shift = level * SlotBits;
+                if ((_currentTick & ((uint64_t(1) << shift) - 1)) != 0) {
+                    continue;
+                }
+
+                size_t index = slotIndex(level, _currentTick);
+                List list = _slots[index];
+                if (list.head == npos) {
+                    continue;
+                }
+
+                _slots[index] = List{};
+                _occupied[level] &= ~(uint64_t(1) << (index & SlotMask));
+
+                for (uint32_t i = list.head; i != npos;) {
+                    uint32_t next = _entries[i].next;
+                    place(i);
+                    i = next;
+                }
+            }
+        }
+
+        void expireSlot(TimePoint now, bool onlyDue)
+        {
+            size_t index = slotIndex(0, _currentTick);
+            _scratch.clear();
+
+            for (uint32_t i = _slots[index].head; i != npos;) {
+                uint32_t next = _entries[i].next;
+                Entry &entry = _entries[i];
+
+                if (entry.tick > _currentTick) {
+                    // Clamped into the last slot of the wheel, put it back
+                    unlink(i);
+                    place(i);
+                } else if (!onlyDue || entry.deadline <= now) {
+                    unlink(i);
+                    _scratch.push_back(i);
+                }
+                i = next;
+            }
+
+            std::sort(_scratch.begin(), _scratch.end(), [this](uint32_t left, uint32_t right) {
+                const Entry &l = _entries[left];
+                const Entry &r = _entries[right];
+                return l.deadline < r.deadline || (l.deadline == r.deadline && l.sequence < r.sequence);
+            });
+
+            for (auto i : _scratch) {
+                append(_expired, ExpiredList, i);
+            }
+        }
+
+        void place(uint32_t index)
+        {
+            Entry &entry = _entries[index];
+
+            // Everything beyond the range of the top level is parked in the
+            // last slot of the wheel and re-placed when it gets there.
+            uint64_t lastTick = _currentTick | ((uint64_t(1) << (Levels * SlotBits)) - 1);
+            uint64_t tick = std::min(std::max(entry.tick, _currentTick), lastTick);
+
+            uint64_t differentBits = tick ^ _currentTick;
+            int level = 0;
+            if (differentBits != 0) {
+                level = (63 - countLeadingZeros(differentBits)) / SlotBits;
+            }
+
+            size_t slot = slotIndex(level, tick);
+            append(_slots[slot], static_cast<int>(slot), index);
+            _occupied[level] |= uint64_t(1) << (slot & SlotMask);
+        }
+
+        List &listOf(int list) { return list == ExpiredList ? _expired : _slots[static_cast<size_t>(list)]; }
+
+        void append(List &list, int listId, uint32_t index)
+        {
+            Entry &entry = _entries[index];
+            entry.list = listId;
+            entry.next = npos;
+            entry.prev = list.tail;
+            if (list.tail != npos) {
+                _entries[list.tail].next = index;
+            } else {
+                list.head = index;
+            }
+            list.tail = index;
+        }
+
+        void unlink(uint32_t index)
+        {
+            Entry &entry = _entries[index];
+            List &list = listOf(entry.list);
+
+            if (entry.prev != npos) {
+                _entries[entry.prev].next = entry.next;
+            } else {
+                list.head = entry.next;
+            }
+            if (entry.next != npos) {
+                _entries[entry.next].prev = entry.prev;
+            } else {
+                list.tail = entry.prev;
+            }
+
+            if (entry.list != ExpiredList && list.head == npos) {
+                int level = entry.list / SlotsPerLevel;
+                _occupied[static_cast<size_t>(level)] &= ~(uint64_t(1) << (entry.list % SlotsPerLevel));
+            }
+
+            entry.prev = entry.next = npos;
+            entry.list = FreeList;
+        }
+
+        uint32_t allocate()
+        {
+            if (_freeHead != npos) {
+                uint32_t index = _freeHead;
+                _freeHead = _entries[index].next;
+                return index;
+            }
+            _entries.emplace_back();
+            return static_cast<uint32_t>(_entries.size() - 1);
+        }
+
+        void release(uint32_t index)
+        {
+            Entry &entry = _entries[index];
+            entry.value.reset();
+            entry.generation = (entry.generation + 1) & GenerationMask;
+            entry.list = FreeList;
+            entry.prev = npos;
+            entry.next = _freeHead;
+            _freeHead = index;
+            _size--;
+        }
+
+        static int countTrailingZeros(uint64_t value)
+        {
+#if defined(_MSC_VER)
+            unsigned long result;
+            _BitScanForward64(&result, value);
+            return static_cast<int>(result);
+#else
+            return __builtin_ctzll(value);
+#endif
+        }
+
+        static int countLeadingZeros(uint64_t value)
+        {
+#if defined(_MSC_VER)
+            unsigned long result;
+            _BitScanReverse64(&result, value);
+            return 63 - static_cast<int>(result);
+#else
+            return __builtin_clzll(value);
+#endif
+        }
+
+      private:
+        TimePoint _origin;
+        Duration _resolution;
+        uint64_t _currentTick = 0;
+        uint64_t _nextSequence = 0;
+
+        std::vector<Entry> _entries;
+        uint32_t _freeHead = npos;
+        size_t _size = 0;
+
+        std::array<List, Levels * SlotsPerLevel> _slots;
+        std::array<uint64_t, Levels> _occupied{};
+        List _expired;
+
+        std::vector<uint32_t> _scratch;
+    };
+}
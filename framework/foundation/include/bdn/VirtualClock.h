@@ -0,0 +1,75 @@
+#pragma once
+
+#include <bdn/DispatchQueue.h>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace bdn
+{
+    /** Time source for DispatchQueue that only moves when told to.
+
+        Queues created with a VirtualClock never wait for a deadline on their
+        own. advanceBy() and advanceTo() step from one deadline to the next
+        and run whatever is due at each of them, on every attached queue, in
+        deadline order. No real time passes while doing so, so hours of
+        timers can be simulated in milliseconds.
+
+        Queues without a thread of their own are processed on the calling
+        thread. For all other queues the call blocks until their thread has
+        caught up. Advancing from within a function running on an attached
+        queue processes that queue recursively.
+
+        Attached queues must not be destroyed while the clock is advancing.
+    */
+    class VirtualClock : public DispatchQueue::TimeSource
+    {
+      public:
+        using Clock = DispatchQueue::Clock;
+        using TimePoint = DispatchQueue::TimePoint;
+
+      public:
+        explicit VirtualClock(TimePoint start = Clock::now()) : _now(start.time_since_epoch().count()) {}
+
+        TimePoint now() const override { return TimePoint(Clock::duration(_now.load(std::memory_order_acquire))); }
+        bool isVirtual() const override { return true; }
+
+        void advanceBy(Clock::duration duration) { advanceTo(now() + duration); }
+
+        /** Moves the clock forward to time and runs everything that is due
+            until then. Times in the past only run what is already due. */
+        void advanceTo(TimePoint time);
+
+        /** Runs everything that is due right now without moving the clock. */
+        void runDue() { advanceTo(now()); }
+
+        /** Moves the clock forward without running anything, as if every
+            attached queue was blocked for duration. Called from a function
+            running on an attached queue it models a function that takes
+            that long. Whatever became due meanwhile is overdue and runs on
+            the next advance, or right away if the queue is being processed
+            already. */
+        void jumpBy(Clock::duration duration);
+
+        /** The earliest point in time at which one of the attached queues
+            has something to do. */
+        std::optional<TimePoint> nextDue();
+
+      protected:
+        void attach(DispatchQueue *queue) override;
+        void detach(DispatchQueue *queue) override;
+
+      private:
+        std::vector<DispatchQueue *> queues();
+        void set(TimePoint time);
+
+      private:
+        std::atomic<Clock::rep> _now;
+
+        std::mutex _queuesMutex;
+        std::vector<DispatchQueue *> _queues;
+
+        std::recursive_mutex _advanceMutex;
+    };
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace bdn
+{
+    /** Chase-Lev work-stealing deque.
+
+        The owning thread pushes and pops at the bottom, any number of other
+        threads may steal from the top concurrently. Uses the memory orderings
+        from "Correct and Efficient Work-Stealing for Weak Memory Models"
+        (Lê, Pop, Cohen, Zappa Nardelli 2013).
+
+        T must be trivially copyable, usually it is a pointer. The buffer
+        grows on demand. Old buffers are kept until the deque is destroyed
+        because a thief might still be reading from them.
+    */
+    template <class T> class WorkStealingDeque
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "WorkStealingDeque requires trivially copyable elements");
+
+      private:
+        class Array
+        {
+          public:
+            explicit Array(int64_t capacity)
+                : _capacity(capacity), _mask(capacity - 1), _slots(new std::atomic<T>[capacity])
+            {}
+
+            int64_t capacity() const { return _capacity; }
+
+            T get(int64_t index) const { return _slots[index & _mask].load(std::memory_order_relaxed); }
+            void put(int64_t index, T value) { _slots[index & _mask].store(value, std::memory_order_relaxed); }
+
+            std::unique_ptr<Array> grow(int64_t bottom, int64_t top) const
+            {
+                auto array = std::make_unique<Array>(_capacity * 2);
+                for (int64_t i = top; i < bottom; i++) {
+                    array->put(i, get(i));
+                }
+                return array;
+            }
+
+          private:
+            int64_t _capacity;
+            int64_t _mask;
+            std::unique_ptr<std::atomic<T>[]> _slots;
+        };
+
+      public:
+        explicit WorkStealingDeque(int64_t initialCapacity = 64)
+        {
+            int64_t capacity = 1;
+            while (capacity < initialCapacity) {
+                capacity *= 2;
+            }
+            _arrays.push_back(std::make_unique<Array>(capacity));
+            _array.store(_arrays.back().get(), std::memory_order_relaxed);
+        }
+
+        WorkStealingDeque(const WorkStealingDeque &) = delete;
+        WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+
+      public:
+        /** Owner only. */
+        void push(T value)
+        {
+            int64_t bottom = _bottom.load(std::memory_order_relaxed);
+            int64_t top = _top.load(std::memory_order_acquire);
+            Array *array = _array.load(std::memory_order_relaxed);
+
+            if (bottom - top > array->capacity() - 1) {
+                _arrays.push_back(array->grow(bottom, top));
+                array = _arrays.back().get();
+                _array.store(array, std::memory_order_release);
+            }
+
+            array->put(bottom, value);
+            std::atomic_thread_fence(std::memory_order_release);
+            _bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+
+        /** Owner only. Takes the most recently pushed element. */
+        bool pop(T &value)
+        {
+            int64_t bottom = _bottom.load(std::memory_order_relaxed) - 1;
+            Array *array = _array.load(std::memory_order_relaxed);
+            _bottom.store(bottom, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t top = _top.load(std::memory_order_relaxed);
+
+            if (top > bottom) {
+                _bottom.store(bottom + 1, std::memory_order_relaxed);
+                return false;
+            }
+
+            value = array->get(bottom);
+            if (top == bottom) {
+                // Last element, race against thieves for it
+                bool won = _top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                                        std::memory_order_relaxed);
+                _bottom.store(bottom + 1, std::memory_order_relaxed);
+                return won;
+            }
+            return true;
+        }
+
+        /** Any thread. Takes the oldest element. Can fail spuriously when
+            racing with another thief or the owner. */
+        bool steal(T &value)
+        {
+            int64_t top = _top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t bottom = _bottom.load(std::memory_order_acquire);
+
+            if (top >= bottom) {
+                return false;
+            }
+
+            Array *array = _array.load(std::memory_order_acquire);
+            value = array->get(top);
+            return _top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        }
+
+        bool empty() const
+        {
+            int64_t bottom = _bottom.load(std::memory_order_relaxed);
+            int64_t top = _top.load(std::memory_order_relaxed);
+            return bottom <= top;
+        }
+
+      private:
+        alignas(64) std::atomic<int64_t> _top{0};
+        alignas(64) std::atomic<int64_t> _bottom{0};
+        std::atomic<Array *> _array{nullptr};
+        std::vector<std::unique_ptr<Array>> _arrays;
+    };
+}
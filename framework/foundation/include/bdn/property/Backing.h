@@ -1,6 +1,10 @@
 #pragma once
 
 #include <bdn/Notifier.h>
+#include <bdn/property/DependencyRecorder.h>
+#include <bdn/property/PropagationScheduler.h>
+#include <bdn/property/PropertyTransaction.h>
+#include <algorithm>
 #include <memory>
 #include <utility>
 #include <vector>
@@ -11,6 +15,8 @@ namespace bdn
 
     template <class ValType> class Backing : public std::enable_shared_from_this<Backing<ValType>>
     {
+        template <class OtherType> friend class Backing;
+
       public:
         class Proxy
         {
@@ -31,7 +37,11 @@ namespace bdn
 
       public:
         Backing() {}
-        virtual ~Backing() { unbind(); }
+        virtual ~Backing()
+        {
+            PropertyTransaction::cancel(this);
+            unbind();
+        }
 
         virtual ValType get() const = 0;
         virtual void set(const ValType &value, bool notify = true) = 0;
@@ -46,14 +56,45 @@ namespace bdn
                               std::is_constructible<OtherType, ValType>::value,
                           "Types are not convertible");
 
-            auto subscription = sourceBacking->onChange().subscribe(
-                [this](const auto &sourceBacking) { this->bindSourceChanged(sourceBacking); });
+            raiseDepth(sourceBacking->_depth + 1);
+            auto depthSubscription =
+                sourceBacking->_depthNotifier.subscribe([this](size_t sourceDepth) { raiseDepth(sourceDepth + 1); });
+
+            // Set while this binding updates its target. A change that comes
+            // back around to it went through a cycle and ends there, as does
+            // one that comes back to the backing it started from.
+            auto updating = std::make_shared<bool>(false);
+
+            auto subscription = sourceBacking->_bindingNotifier.subscribe([this, updating](const auto &source) {
+                if (*updating || PropagationScheduler::isOrigin(this)) {
+                    return;
+                }
+
+                auto update = [this, updating, weakSource = std::weak_ptr<Backing<OtherType>>(source)]() {
+                    if (auto source = weakSource.lock()) {
+                        *updating = true;
+                        try {
+                            PropagationScheduler::updateBindingTarget(this, [&]() { this->bindSourceChanged(source); });
+                        }
+                        catch (...) {
+                            *updating = false;
+                            throw;
+                        }
+                        *updating = false;
+                    }
+                };
+
+                if (!PropagationScheduler::schedule({this, updating.get()}, _depth, update)) {
+                    update();
+                }
+            });
 
             std::weak_ptr<Backing<OtherType>> weakSourceBacking = sourceBacking;
 
-            Binding binding = [subscription, weakSourceBacking]() {
+            Binding binding = [subscription, depthSubscription, weakSourceBacking]() {
                 if (auto source = weakSourceBacking.lock()) {
-                    source->onChange().unsubscribe(subscription);
+                    source->_bindingNotifier.unsubscribe(subscription);
+                    source->_depthNotifier.unsubscribe(depthSubscription);
                 }
             };
 
@@ -62,6 +103,30 @@ namespace bdn
             bindSourceChanged(sourceBacking);
         }
 
+        /** Makes this backing a dependency of the ComputedBacking that is
+            being computed on this thread, if any. */
+        void recordRead()
+        {
+            auto recorder = DependencyRecorder::current();
+            if (recorder == nullptr) {
+                return;
+            }
+
+            auto subscribe = [this](const std::function<void()> &changed,
+                                    const std::function<void(size_t)> &deepened) -> DependencyRecorder::Unsubscribe {
+                auto subscription = _bindingNotifier.subscribe([changed](const auto &) { changed(); });
+                auto depthSubscription = _depthNotifier.subscribe(deepened);
+                std::weak_ptr<Backing<ValType>> weakSelf = this->shared_from_this();
+                return [weakSelf, subscription, depthSubscription]() {
+                    if (auto self = weakSelf.lock()) {
+                        self->_bindingNotifier.unsubscribe(subscription);
+                        self->_depthNotifier.unsubscribe(depthSubscription);
+                    }
+                };
+            };
+            recorder->record(this, _depth, subscribe);
+        }
+
         void unbind()
         {
             for (const auto &unbind : _bindings) {
@@ -76,11 +141,63 @@ namespace bdn
             set(sourceBacking->get());
         }
 
+      protected:
+        /** Raises the depth to at least depth and passes the increase on to
+            everything that depends on this backing, so that a backing
+            stays deeper than its sources when they get deeper after it was
+            bound to them. An increase that comes back around a cycle ends
+            there. */
+        void raiseDepth(size_t depth)
+        {
+            if (depth <= _depth || _raisingDepth) {
+                return;
+            }
+
+            _depth = depth;
+            _raisingDepth = true;
+            try {
+                _depthNotifier.notify(_depth);
+            }
+            catch (...) {
+                _raisingDepth = false;
+                throw;
+            }
+            _raisingDepth = false;
+        }
+
+        /** To be called by subclasses whenever the value changed. Bound
+            backings follow right away, onChange() subscribers are notified
+            when the current PropertyTransaction commits, if there is one. */
+        void notifyChange()
+        {
+            auto self = this->shared_from_this();
+            auto origin = PropagationScheduler::originOf(this);
+            auto deferred = [this]() { _onChange.notify(this->shared_from_this()); };
+            if (!PropertyTransaction::defer(this, deferred, _depth)) {
+                _onChange.notify(self);
+            }
+            PropagationScheduler::propagate(origin, [&]() { _bindingNotifier.notify(self); });
+        }
+
       protected:
         notifier_t _onChange;
 
+        // Backings bound to this one and computed backings depending on it,
+        // kept apart from _onChange so that they stay up to date inside
+        // transactions
+        notifier_t _bindingNotifier;
+
         using Binding = std::function<void()>;
 
         std::vector<Binding> _bindings;
+
+        // Longest path from a backing without bindings or dependencies.
+        // Only used to order updates in a PropagationScheduler.
+        size_t _depth = 0;
+
+        // Backings bound to this one and computed backings depending on it,
+        // told about every increase of _depth
+        Notifier<size_t> _depthNotifier;
+        bool _raisingDepth = false;
     };
 }
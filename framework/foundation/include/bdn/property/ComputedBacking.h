@@ -0,0 +1,145 @@
+#pragma once
+
+#include <bdn/property/Backing.h>
+#include <bdn/property/DependencyRecorder.h>
+#include <bdn/property/PropagationScheduler.h>
+#include <bdn/property/PropertyTransaction.h>
+#include <bdn/property/ValueBacking.h>
+
+#include <functional>
+#include <optional>
+#include <stdexcept>
+
+namespace bdn
+{
+    /** Read-only backing whose value is computed from other properties.
+
+        Every Property read through get() while the function runs becomes a
+        dependency. The result is cached. When a dependency changes the
+        backing only marks itself dirty and recomputes on the next get(),
+        unless somebody observes it through onChange() or a binding. Then it
+        recomputes right away, or when the current PropertyTransaction
+        commits, and notifies only if the value actually changed.
+        Dependencies are collected anew on every computation, so functions
+        may read different properties depending on their state.
+
+        Dependencies are only known after the first computation. Property
+        does that when it is constructed from a ComputedBacking. A function
+        that ends up reading its own value throws std::logic_error.
+    */
+    template <class ValType> class ComputedBacking : public Backing<ValType>
+    {
+      public:
+        using Function = std::function<ValType()>;
+
+      public:
+        explicit ComputedBacking(Function compute) : _compute(std::move(compute)) {}
+        ComputedBacking(const ComputedBacking &other) : _compute(other._compute) {}
+
+        ~ComputedBacking() override
+        {
+            PropertyTransaction::cancel(&_refreshScheduled);
+            for (auto &dependency : _dependencies) {
+                dependency.unsubscribe();
+            }
+        }
+
+      public:
+        ValType get() const override
+        {
+            if (_dirty) {
+                recompute();
+            }
+            return *_value;
+        }
+
+        void set(const ValType &value, bool notify = true) override
+        {
+            throw std::logic_error("A ComputedBacking cannot be set");
+        }
+
+      private:
+        bool observed() const { return !this->_onChange.empty() || !this->_bindingNotifier.empty(); }
+
+        void dependencyChanged()
+        {
+            _dirty = true;
+            if (!observed()) {
+                return;
+            }
+
+            // The scheduler keeps track of queued updates itself
+            if (PropagationScheduler::schedule({this, nullptr}, this->_depth, [this]() { refresh(); })) {
+                return;
+            }
+
+            if (_refreshScheduled) {
+                return;
+            }
+
+            _refreshScheduled = true;
+            if (!PropertyTransaction::defer(&_refreshScheduled, [this]() { refresh(); }, this->_depth)) {
+                refresh();
+            }
+        }
+
+        void refresh()
+        {
+            _refreshScheduled = false;
+            if (_dirty) {
+                recompute();
+            }
+            if (_changeUnnotified) {
+                _changeUnnotified = false;
+                this->notifyChange();
+            }
+        }
+
+        void recompute() const
+        {
+            if (_computing) {
+                throw std::logic_error("ComputedBacking depends on its own value");
+            }
+
+            auto self = const_cast<ComputedBacking *>(this);
+            DependencyRecorder recorder([self]() { self->dependencyChanged(); },
+                                        [self](size_t dependencyDepth) { self->raiseDepth(dependencyDepth + 1); },
+                                        std::move(_dependencies));
+
+            _computing = true;
+            try {
+                ValType value = _compute();
+                _computing = false;
+                _dependencies = recorder.finish();
+                // Dependents stay as deep as they are if this backing got
+                // shallower, they are still ordered after it
+                if (recorder.depth() > this->_depth) {
+                    self->raiseDepth(recorder.depth());
+                } else {
+                    self->_depth = recorder.depth();
+                }
+                _dirty = false;
+
+                if (!_value || ValueBacking<ValType>::template Compare<ValType>::notEqual(*_value, value)) {
+                    _value = std::move(value);
+                    _changeUnnotified = _changeUnnotified || observed();
+                }
+            }
+            catch (...) {
+                _computing = false;
+                _dependencies = recorder.keepAll();
+                throw;
+            }
+        }
+
+      private:
+        Function _compute;
+
+        mutable std::optional<ValType> _value;
+        mutable DependencyRecorder::Dependencies _dependencies;
+        mutable bool _dirty = true;
+        mutable bool _changeUnnotified = false;
+        mutable bool _computing = false;
+        bool _refreshScheduled = false;
+    };
+}
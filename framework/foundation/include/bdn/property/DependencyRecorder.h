@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace bdn
+{
+    /** Collects the backings read while a ComputedBacking computes its
+        value.
+
+        While a recorder exists it is the current one of its thread.
+        Backing::recordRead() registers the reading backing through
+        record(), which subscribes the recorder's callbacks unless the
+        dependency is subscribed already: changed for changes of its value,
+        deepened for increases of its depth in the binding graph. Recorders nest, so computed values
+        may depend on other computed values.
+    */
+    class DependencyRecorder
+    {
+      public:
+        using Unsubscribe = std::function<void()>;
+
+        struct Dependency
+        {
+            const void *key;
+            Unsubscribe unsubscribe;
+        };
+        using Dependencies = std::vector<Dependency>;
+
+      public:
+        /** Dependencies in previous stay subscribed if they are read again. */
+        DependencyRecorder(std::function<void()> changed, std::function<void(size_t)> deepened,
+                           Dependencies previous)
+            : _changed(std::move(changed)), _deepened(std::move(deepened)), _previous(std::move(previous)),
+              _outer(t_current)
+        {
+            t_current = this;
+        }
+        ~DependencyRecorder() { t_current = _outer; }
+
+        DependencyRecorder(const DependencyRecorder &) = delete;
+        DependencyRecorder &operator=(const DependencyRecorder &) = delete;
+
+        static DependencyRecorder *current() { return t_current; }
+
+      public:
+        /** subscribe is called with the callbacks to subscribe if key is not
+            a dependency yet, and returns how to unsubscribe them again. depth
+            is the dependency's depth in the binding graph. */
+        template <class Subscribe> void record(const void *key, size_t depth, Subscribe &&subscribe)
+        {
+            _depth = std::max(_depth, depth + 1);
+
+            auto byKey = [key](const Dependency &dependency) { return dependency.key == key; };
+
+            if (std::find_if(_dependencies.begin(), _dependencies.end(), byKey) != _dependencies.end()) {
+                return;
+            }
+
+            auto previous = std::find_if(_previous.begin(), _previous.end(), byKey);
+            if (previous != _previous.end()) {
+                _dependencies.push_back(std::move(*previous));
+                _previous.erase(previous);
+                return;
+            }
+
+            _dependencies.push_back({key, subscribe(_changed, _deepened)});
+        }
+
+        /** One more than the deepest dependency read, 0 without any. */
+        size_t depth() const { return _depth; }
+
+        /** Unsubscribes from previous dependencies that were not read this
+            time and returns the ones that were. */
+        Dependencies finish()
+        {
+            for (auto &dependency : _previous) {
+                dependency.unsubscribe();
+            }
+            _previous.clear();
+            return std::move(_dependencies);
+        }
+
+        /** Returns all dependencies, old and new. Used if the computation
+            failed. */
+        Dependencies keepAll()
+        {
+            for (auto &dependency : _previous) {
+                _dependencies.push_back(std::move(dependency));
+            }
+            _previous.clear();
+            return std::move(_dependencies);
+        }
+
+      private:
+        std::function<void()> _changed;
+        std::function<void(size_t)> _deepened;
+        Dependencies _previous;
+        Dependencies _dependencies;
+        DependencyRecorder *_outer;
+        size_t _depth = 0;
+
+        static inline thread_local DependencyRecorder *t_current = nullptr;
+    };
+}
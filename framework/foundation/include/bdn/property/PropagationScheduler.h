@@ -0,0 +1,80 @@
+#pragma once
+
+#include <bdn/Task.h>
+
+#include <cstddef>
+#include <functional>
+
+namespace bdn
+{
+    /** Opts the current thread into ordered propagation of property
+        changes.
+
+        By default a change runs through bindings and computed backings
+        depth first, so in a diamond (A to B, A to C, B and C to D) D is
+        updated twice and once sees B's new and C's old value. While a
+        scheduler exists on a thread, a change first collects the backings
+        depending on the changed one. It then updates them in order of their
+        depth in the binding graph, i.e. after everything they depend on.
+        Depths are kept up to date when bindings are added, so each backing
+        is normally updated once per change. One that changes again after
+        it was updated, e.g. because a computed backing started to read a
+        deeper dependency, is updated again. Updates that would revisit a
+        backing that caused them come from a cycle and are dropped.
+
+        With or without a scheduler, bindings never update the backing whose
+        change started the propagation, so it is notified exactly once even
+        if the change comes back to it through a cycle. Changes made by
+        onChange() subscribers start propagations of their own.
+
+        Everything runs before the set() that started the change returns.
+        Schedulers nest, so a thread can keep one around for good.
+    */
+    class PropagationScheduler
+    {
+      public:
+        /** Identifies an update: the backing to update and the edge of the
+            binding graph it comes from, if it has several. */
+        struct Key
+        {
+            const void *target;
+            const void *edge;
+
+            bool operator==(const Key &other) const { return target == other.target && edge == other.edge; }
+        };
+
+      public:
+        PropagationScheduler();
+        ~PropagationScheduler();
+
+        PropagationScheduler(const PropagationScheduler &) = delete;
+        PropagationScheduler &operator=(const PropagationScheduler &) = delete;
+
+      public:
+        static bool isActive();
+
+        /** Runs notifyDependents, which updates or schedules the updates of
+            the backings depending on a changed one, with origin as the
+            origin of the propagation. Unless a scheduled propagation is
+            already running the scheduled updates then run in depth order. */
+        static void propagate(const void *origin, const std::function<void()> &notifyDependents);
+
+        /** Runs update, in which a binding changes target. */
+        static void updateBindingTarget(const void *target, const std::function<void()> &update);
+
+        /** The origin to propagate a change of changed with: the running
+            propagation's origin if a binding made the change, otherwise
+            changed itself. To be called once per change, before any
+            subscriber runs. */
+        static const void *originOf(const void *changed);
+
+        /** True if the propagation running on this thread started from a
+            change of backing. */
+        static bool isOrigin(const void *backing);
+
+        /** Queues update unless it is queued already or its target caused
+            the running update, and returns true. Returns false if no
+            propagation is running, the caller then updates right away. */
+        static bool schedule(Key key, size_t depth, Task update);
+    };
+}
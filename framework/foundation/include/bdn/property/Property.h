@@ -1,7 +1,11 @@
 #pragma once
 
+#include <memory>
+#include <optional>
 #include <string>
+#include <type_traits>
 
+#include <bdn/property/ComputedBacking.h>
 #include <bdn/property/GetterSetterBacking.h>
 #include <bdn/property/SetterBacking.h>
 #include <bdn/property/StreamBacking.h>
@@ -18,6 +22,18 @@ namespace bdn
         bidirectional
     };
 
+    /** Value with change notifications that can be bound to other
+        properties.
+
+        A plain value lives inside the property. The shared backing and the
+        notifier for onChange() are only allocated once they are needed, i.e.
+        on the first call of backing(), bind() or onChange(), so that objects
+        with many properties that nobody observes stay small. A property only
+        subscribes to its backing once onChange() was called.
+
+        Reads through get() inside the function of a ComputedBacking make the
+        property a dependency of it.
+    */
     template <class ValType> class Property
     {
       private:
@@ -43,24 +59,33 @@ namespace bdn
 
         using notifier_t = Notifier<Property &>;
 
+        // Values that cannot be copied out of the property always live in a
+        // backing, as before.
+        static constexpr bool storesInline = std::is_copy_constructible_v<ValType>;
+
       public:
         using backing_t = Backing<ValType>;
 
-        Property() : _backing(std::make_shared<value_backing_t>()) { init(); }
+        Property()
+        {
+            if constexpr (storesInline) {
+                _value.emplace();
+            } else {
+                _backing = std::make_shared<value_backing_t>();
+                init();
+            }
+        }
         Property(Property &other) : _backing(other.backing()) { init(); }
         Property(const Property &) = delete;
         ~Property()
         {
+            PropertyTransaction::cancel(this);
             if (_backing) {
                 _backing->onChange().unsubscribe(_forwardSub);
             }
         }
 
-        Property(ValType value) : _backing(std::make_shared<value_backing_t>())
-        {
-            init();
-            set(value, false /* do not notify on initial set */);
-        }
+        Property(ValType value) : _value(std::move(value)) {}
 
         Property(const GetterSetterBacking<ValType> &getterSetter)
         {
@@ -86,6 +111,15 @@ namespace bdn
             init();
         }
 
+        /** Computes the first value right away, so that changes of the
+            dependencies are noticed from the start. */
+        Property(const ComputedBacking<ValType> &computed)
+        {
+            _backing = std::make_shared<ComputedBacking<ValType>>(computed);
+            init();
+            _backing->get();
+        }
+
         Property(std::shared_ptr<Backing<ValType>> backing)
         {
             _backing = backing;
@@ -93,38 +127,79 @@ namespace bdn
         }
 
         template <class _Rep, class _Period>
-        Property(const std::chrono::duration<_Rep, _Period> &duration) : _backing(std::make_shared<value_backing_t>())
+        Property(const std::chrono::duration<_Rep, _Period> &duration)
+            : _value(std::chrono::duration_cast<ValType>(duration))
+        {}
+
+      public:
+        ValType get() const
         {
-            init();
-            set(std::chrono::duration_cast<ValType>(duration), false);
+            if (DependencyRecorder::current() != nullptr) {
+                backing()->recordRead();
+            }
+
+            if constexpr (storesInline) {
+                if (!_backing) {
+                    return *_value;
+                }
+            }
+            return _backing->get();
         }
 
-      public:
-        ValType get() const { return _backing->get(); }
-        void set(ValType value, bool notify = true) { _backing->set(value, notify); }
+        void set(ValType value, bool notify = true)
+        {
+            if constexpr (storesInline) {
+                if (!_backing) {
+                    // Same as ValueBacking::set()
+                    if (value_backing_t::template Compare<ValType>::notEqual(*_value, value)) {
+                        _value = std::move(value);
+                        if (notify) {
+                            notifyInlineChange();
+                        }
+                    }
+                    return;
+                }
+            }
+            _backing->set(value, notify);
+        }
 
-        const auto backing() const { return _backing; }
+        /** Moves an inline value into a ValueBacking first. */
+        const auto backing() const
+        {
+            if constexpr (storesInline) {
+                if (!_backing) {
+                    _backing = std::make_shared<value_backing_t>(std::move(*_value));
+                    _value.reset();
+                    init();
+                }
+            }
+            return _backing;
+        }
 
       public:
+        /** Bidirectional bindings form a cycle. A change ends when it comes
+            back to the property it started from, so values that cannot be
+            compared can be bound both ways too. */
         template <class OtherType>
         void bind(const Property<OtherType> &sourceProperty, BindMode bindMode = BindMode::bidirectional)
         {
-            if ((!ValueBacking<ValType>::template Compare<ValType>::isComparable ||
-                 !ValueBacking<ValType>::template Compare<OtherType>::isComparable) &&
-                bindMode == BindMode::bidirectional) {
-                throw std::logic_error(
-                    "You cannot bind this type of Property bidirectionally, its == operator is faked "
-                    "and therefore would end up in an endless loop.");
-            }
-
-            _backing->bind(sourceProperty.backing());
+            backing()->bind(sourceProperty.backing());
             if (bindMode == BindMode::bidirectional) {
-                sourceProperty.backing()->bind(_backing);
+                sourceProperty.backing()->bind(backing());
             }
         }
 
       public:
-        auto &onChange() const { return _onChange; }
+        auto &onChange() const
+        {
+            if (!_onChange) {
+                _onChange = std::make_unique<notifier_t>();
+                if (_backing) {
+                    init();
+                }
+            }
+            return *_onChange;
+        }
 
       public:
         template <typename U = ValType, typename std::enable_if<overloadsArrowOperator<U>::value, int>::type = 0>
@@ -136,6 +211,11 @@ namespace bdn
         template <typename U = ValType, typename std::enable_if<!overloadsArrowOperator<U>::value, int>::type = 0>
         const typename backing_t::Proxy operator->() const
         {
+            if constexpr (storesInline) {
+                if (!_backing) {
+                    return typename backing_t::Proxy(*_value);
+                }
+            }
             return _backing->proxy();
         }
 
@@ -169,7 +249,7 @@ namespace bdn
                 return *this;
             }
 
-            _backing->set(otherProperty.backing()->get());
+            set(otherProperty.get());
             return *this;
         }
 
@@ -289,20 +369,38 @@ namespace bdn
             return *this;
         }
 
-        void forwardNotification() { _onChange.notify(*this); }
+        void forwardNotification()
+        {
+            if (_onChange) {
+                _onChange->notify(*this);
+            }
+        }
 
       private:
-        void init()
+        // Backings do the same in Backing::notifyChange()
+        void notifyInlineChange()
         {
-            _forwardSub = _backing->onChange().subscribe(std::bind(&Property<ValType>::forwardNotification, this));
+            if (_onChange && !PropertyTransaction::defer(this, [this]() { forwardNotification(); })) {
+                forwardNotification();
+            }
+        }
+
+        // Forwards the backing's notifications once somebody listens
+        void init() const
+        {
+            if (_onChange && !_forwardSub) {
+                auto self = const_cast<Property *>(this);
+                _forwardSub = _backing->onChange().subscribe(std::bind(&Property<ValType>::forwardNotification, self));
+            }
         }
 
       private:
-        typename backing_t::notifier_t::Subscription _forwardSub;
+        // Holds the value until a backing is needed
+        mutable std::optional<ValType> _value;
         mutable std::shared_ptr<backing_t> _backing;
-        mutable bool _isConnected = false;
+        mutable typename backing_t::notifier_t::Subscription _forwardSub;
 
-        mutable notifier_t _onChange;
+        mutable std::unique_ptr<notifier_t> _onChange;
     };
 
     template <typename CHAR_TYPE, class CHAR_TRAITS, typename PROP_VALUE>
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <bdn/Task.h>
+
+#include <cstddef>
+
+namespace bdn
+{
+    /** Groups property changes into one update.
+
+        While a transaction is active on a thread, onChange() notifications
+        of every Property and Backing changed on that thread are held back.
+        Values change right away and bindings follow immediately, so reads
+        inside the transaction are consistent. When the outermost
+        transaction commits, each changed property is notified once with its
+        final value. Properties are notified in order of their depth in the
+        binding graph, so bound and computed properties come after the ones
+        they depend on, and in the order in which they first changed within
+        the same depth. Properties changed by those notifications are
+        notified in the same commit, after the ones that changed them.
+
+        Transactions nest; inner ones only end their scope. The destructor
+        commits unless commit() was called. If a subscriber throws during
+        commit() the remaining notifications are dropped and the exception
+        propagates. The destructor logs and ignores it instead, so call
+        commit() explicitly if subscribers may throw.
+
+        Properties changed inside a transaction must not be destroyed on
+        other threads before it commits.
+    */
+    class PropertyTransaction
+    {
+      public:
+        /** Identifies the object whose notification is held back. */
+        using Key = const void *;
+
+      public:
+        PropertyTransaction();
+        ~PropertyTransaction();
+
+        PropertyTransaction(const PropertyTransaction &) = delete;
+        PropertyTransaction &operator=(const PropertyTransaction &) = delete;
+
+        /** Delivers the held back notifications if this is the outermost
+            transaction. Does nothing when called a second time. */
+        void commit();
+
+      public:
+        /** True while a transaction is active on the calling thread,
+            including while it commits. */
+        static bool isActive();
+
+        /** Holds back notify until the transaction commits and returns true,
+            or returns false if no transaction is active. While a
+            notification for key is held back further ones are dropped.
+            depth is the notifying object's depth in the binding graph. */
+        static bool defer(Key key, Task notify, size_t depth = 0);
+
+        /** Drops the notification held back for key. Called by objects that
+            are destroyed. */
+        static void cancel(Key key);
+
+      private:
+        bool _committed = false;
+    };
+}
@@ -23,7 +23,7 @@ namespace bdn
             if (_setter == nullptr) {
                 _value = value;
             } else if (_setter(_value, value) && notify) {
-                this->_onChange.notify(Backing<ValType>::shared_from_this());
+                this->notifyChange();
             }
         }
 
@@ -87,7 +87,7 @@ namespace bdn
         void onPropertyChanged()
         {
             updateValue();
-            _onChange.notify(shared_from_this());
+            notifyChange();
         }
 
       private:
@@ -28,7 +28,7 @@ namespace bdn
                 _otherBacking->onChange().unsubscribe(subscription);
         }
 
-        void otherChanged() { Backing<ValType>::_onChange.notify(Backing<ValType>::shared_from_this()); }
+        void otherChanged() { Backing<ValType>::notifyChange(); }
 
       public:
         ValType get() const override { return toFunc(_otherBacking->get()); }
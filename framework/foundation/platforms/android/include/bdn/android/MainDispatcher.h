@@ -5,6 +5,9 @@
 #include <bdn/android/wrapper/Looper.h>
 #include <bdn/android/wrapper/NativeDispatcher.h>
 
+#include <algorithm>
+#include <atomic>
+
 namespace bdn::android
 {
 
@@ -26,7 +29,9 @@ namespace bdn::android
       protected:
         void notifyWorker(LockType &lk) override;
         void newTimed(LockType &lk) override;
-        void createTimerInternal(std::chrono::duration<double> interval, std::function<bool()> timer) override;
+        CancellationToken createTimerInternal(std::chrono::duration<double> interval, TickFunction timer,
+                                              MissedTickPolicy policy, Clock::duration leeway) override;
+        bool cancelTimed(uint64_t id) override;
 
       private:
         void scheduleCallAt(DispatchQueue::TimePoint at);
@@ -35,23 +40,66 @@ namespace bdn::android
         wrapper::NativeDispatcher _nativeDispatcher;
 
       public:
+        /** Native side of a repeating timer. The Java side posts a call of
+            onEvent() to the looper for every tick and waits for as long as
+            onEvent() returns before the next one. */
         class Timer_
         {
           public:
-            Timer_(const std::function<bool()> &func) { _func = func; }
+            Timer_(TickFunction func, Clock::duration interval, MissedTickPolicy policy, Clock::duration leeway)
+                : _func(std::move(func)), _interval(interval), _policy(policy), _leeway(leeway),
+                  _deadline(Clock::now() + interval)
+            {}
+
+            /** Seconds until the first tick. */
+            double firstDelay() const { return secondsUntilDue(); }
+
+            /** Calls the timer function and returns the seconds until the
+                next tick, or a negative value once the timer has stopped.
 
-            bool onEvent()
+                Ticks stay on the absolute schedule of the timer, the delay
+                is computed anew for every tick, so the timer does not drift
+                with the looper's latency. Within the leeway the delay ends
+                on the same coalesced points as the DispatchQueue deadlines,
+                so timers with leeway share looper wakeups. */
+            double onEvent()
             {
+                auto called = Clock::now();
+                if (called < _deadline) {
+                    // Woken up a little early
+                    return secondsUntilDue();
+                }
+
+                auto missed = missedTicks(_deadline, _interval, _policy, called);
                 try {
-                    return _func();
+                    if (!_func(missed)) {
+                        return -1;
+                    }
                 }
                 catch (std::bad_function_call &) {
+                    return -1;
                 }
-                return false;
+
+                _deadline = nextTick(_deadline, _interval, _policy, called, missed);
+                return secondsUntilDue();
             }
 
           private:
-            std::function<bool()> _func;
+            double secondsUntilDue() const
+            {
+                auto due = coalesce(_deadline, _leeway);
+                return std::max(0.0, std::chrono::duration<double>(due - Clock::now()).count());
+            }
+
+          private:
+            TickFunction _func;
+            Clock::duration _interval;
+            MissedTickPolicy _policy;
+            Clock::duration _leeway;
+            TimePoint _deadline;
         };
+
+      private:
+        std::atomic<uint64_t> _nextTimerId{0};
     };
 }
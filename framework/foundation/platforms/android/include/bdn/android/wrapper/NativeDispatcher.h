@@ -14,10 +14,11 @@ namespace bdn::android::wrapper
 
       protected:
         JavaMethod<void(double, java::wrapper::NativeRunnable, bool)> native_enqueue{this, "enqueue"};
-        JavaMethod<void(double, java::wrapper::NativeStrongPointer)> native_createTimer{this, "createTimer"};
+        JavaMethod<void(int64_t, double, java::wrapper::NativeStrongPointer)> native_createTimer{this, "createTimer"};
 
       public:
         JavaMethod<void()> dispose{this, "dispose"};
+        JavaMethod<bool(int64_t)> cancelTimer{this, "cancelTimer"};
 
       public:
         void enqueue(double delay, const std::function<void()> &func, bool idlePriority)
@@ -35,12 +36,12 @@ namespace bdn::android::wrapper
             return native_enqueue(delay, bdn::java::wrapper::NativeRunnable(runnable.getRef_()), idlePriority);
         }
 
-        void createTimer(std::chrono::duration<double> interval, const std::shared_ptr<void> &timerData)
+        /** The Java side calls the timer for the first time after
+            firstDelay seconds. */
+        void createTimer(uint64_t id, double firstDelay, const std::shared_ptr<void> &timerData)
         {
             bdn::java::wrapper::NativeStrongPointer nativeTimerData(timerData);
-
-            double intervalInSeconds = interval.count();
-            return native_createTimer(intervalInSeconds, nativeTimerData);
+            return native_createTimer(static_cast<int64_t>(id), firstDelay, nativeTimerData);
         }
     };
 }
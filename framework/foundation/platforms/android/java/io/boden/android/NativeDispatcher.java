@@ -7,9 +7,10 @@ import android.os.Handler;
 import android.os.Looper;
 import android.os.MessageQueue;
 
+import java.util.ArrayList;
 import java.util.LinkedList;
+import java.util.HashMap;
 import java.util.HashSet;
-import java.util.Timer;
 
 /** Implements the functionality of bdn::IDispatcher on the Java side.*/
 public class NativeDispatcher
@@ -33,7 +34,7 @@ public class NativeDispatcher
     {
         mNormalQueue = new LinkedList<NativeRunnable>();
         mPendingProcessTimedItemActions = new HashSet< ProcessTimedItemAction >();
-        mTimerTaskSet = new HashSet< NativeTimerTask >();
+        mTimerTasks = new HashMap< Long, NativeTimerTask >();
 
         mHandler = new Handler( looper );
 
@@ -75,8 +76,9 @@ public class NativeDispatcher
 
     /** Calls the native timer event handler and processes any exceptions that occur from it
      *  as uncaught dispatcher exceptions (calling the uncaught exception handler, etc.)
+     *  Returns the seconds until the next call, or a negative value if the timer has stopped.
      */
-    private static boolean callNativeTimerEvent(NativeStrongPointer nativeTimerData)
+    private static double callNativeTimerEvent(NativeStrongPointer nativeTimerData)
     {
         // note that we pass the wrapped pointer directly to the function, instead of
         // the NativeStrongPointer object. That allows the native side to be more efficient
@@ -170,101 +172,96 @@ public class NativeDispatcher
 
 
 
-    private class NativeTimerDispatcherThreadCaller implements Runnable
+    /** Repeating timer. Runs on the dispatcher thread and asks the native side for the
+     *  delay until the next tick every time, so that the native side can keep the timer
+     *  on its schedule.*/
+    private class NativeTimerTask implements Runnable
     {
-        NativeTimerDispatcherThreadCaller(NativeTimerTask task)
+        NativeTimerTask(NativeDispatcher dispatcher, long id, NativeStrongPointer timerData )
         {
-            mTask = task;
+            mDispatcher = dispatcher;
+            mId = id;
+            mTimerData = timerData;
         }
 
-        public void run()
+        // synchronized, so that dispose() from another thread waits for a
+        // running call instead of releasing the native data underneath it.
+        public synchronized void run()
         {
-            mTask.callFromDispatcherThread();
-        }
-
-        private NativeTimerTask mTask;
-    };
+            if(mTimerData==null)
+                return;
 
+            double nextDelaySeconds = callNativeTimerEvent(mTimerData);
 
-    private class NativeTimerTask extends java.util.TimerTask
-    {
-        NativeTimerTask(NativeDispatcher dispatcher, NativeStrongPointer timerData )
-        {
-            mDispatcher = dispatcher;
-            mTimerData = timerData;
-            mCaller = new NativeTimerDispatcherThreadCaller(this);
+            // the timer may have been cancelled from within the call
+            if(mTimerData==null)
+                return;
 
-            mCallPending = false;
+            if(nextDelaySeconds < 0)
+                dispose();
+            else
+                mDispatcher.mHandler.postDelayed(this, toMillis(nextDelaySeconds));
         }
 
-        public void run()
+        /** Returns false if the task was already disposed.*/
+        public synchronized boolean dispose()
         {
-            // this is called from the timer thread. We want it to be called from
-            // the dispatcher thread - so we have to post an action there.
-
-            // if a call is pending then we do not schedule another call.
-            if(mTimerData!=null && !mCallPending)
-            {
-                mCallPending = true;
-                mDispatcher.mHandler.post(mCaller);
-            }
-        }
+            if(mTimerData==null)
+                return false;
 
-        void callFromDispatcherThread()
-        {
-            try
-            {
-                if(mTimerData!=null)
-                {
-                    boolean continueTimer = callNativeTimerEvent(mTimerData);
+            mDispatcher.mHandler.removeCallbacks(this);
 
-                    if (! continueTimer)
-                        dispose();
-                }
-            }
-            finally
-            {
-                mCallPending = false;
-            }
-        }
+            mTimerData.dispose();
+            mTimerData = null;
 
-        public void dispose()
-        {
-            if(mTimerData!=null)
+            synchronized(mDispatcher.mTimerTasks)
             {
-                mTimerData.dispose();
-                mTimerData = null;
-                cancel();
-
-                mDispatcher.mTimerTaskSet.remove(this);
+                mDispatcher.mTimerTasks.remove(mId);
             }
+            return true;
         }
 
         private NativeDispatcher                    mDispatcher;
+        private long                                mId;
         private NativeStrongPointer                 mTimerData;
-        private NativeTimerDispatcherThreadCaller   mCaller;
-
-        private boolean             mCallPending;
     };
 
-    public void createTimer(double intervalSeconds, NativeStrongPointer timerData )
+    /** Rounds up, so that the native side is not woken up before the tick is due.*/
+    private static long toMillis(double seconds)
+    {
+        return (long)Math.ceil(seconds*1000);
+    }
+
+    public void createTimer(long id, double firstDelaySeconds, NativeStrongPointer timerData )
     {
-        NativeTimerTask task = new NativeTimerTask( this, timerData );
+        NativeTimerTask task = new NativeTimerTask( this, id, timerData );
 
-        int intervalMillis = (int)(intervalSeconds*1000);
-        if(intervalMillis<=0)
-            intervalMillis = 1;
+        // a concurrent cancelTimer must not come in between
+        synchronized(task)
+        {
+            synchronized(mTimerTasks)
+            {
+                mTimerTasks.put(id, task);
+            }
+
+            mHandler.postDelayed( task, toMillis(firstDelaySeconds) );
+        }
+    }
 
-        if(mMasterTimer==null)
+    /** Stops the timer with the given id right away. Can be called from any thread.
+     *  Returns false if the timer was not found, e.g. because it has already stopped.*/
+    public boolean cancelTimer(long id)
+    {
+        NativeTimerTask task;
+        synchronized(mTimerTasks)
         {
-            // note that each timer object has a thread running in the background to schedule the
-            // events. So we only use a single timer instance for all of "our" timers.
-            mMasterTimer = new Timer();
+            task = mTimerTasks.get(id);
         }
 
-        mMasterTimer.scheduleAtFixedRate( task, intervalMillis, intervalMillis);
+        if(task==null)
+            return false;
 
-        mTimerTaskSet.add(task);
+        return task.dispose();
     }
 
     public void dispose()
@@ -283,11 +280,13 @@ public class NativeDispatcher
             action.dispose();
 
         // timers
-        while(!mTimerTaskSet.isEmpty())
+        ArrayList<NativeTimerTask> timerTasks;
+        synchronized(mTimerTasks)
         {
-            NativeTimerTask task = mTimerTaskSet.iterator().next();
-            task.dispose();
+            timerTasks = new ArrayList<NativeTimerTask>(mTimerTasks.values());
         }
+        for( NativeTimerTask task: timerTasks)
+            task.dispose();
     }
 
 
@@ -367,17 +366,15 @@ public class NativeDispatcher
     private Handler     mHandler;
     private IdleHandler mIdleHandler;
 
-    private Timer       mMasterTimer;
-
     private LinkedList<NativeRunnable>          mNormalQueue;
     private HashSet< ProcessTimedItemAction >   mPendingProcessTimedItemActions;
-    private HashSet< NativeTimerTask >          mTimerTaskSet;
+    private HashMap< Long, NativeTimerTask >    mTimerTasks;
 
     private ProcessNormalQueueItemAction        mProcessNormalQueueItemAction;
 
 
 
-    private native static boolean nativeTimerEvent(NativeStrongPointer timerData);
+    private native static double nativeTimerEvent(NativeStrongPointer timerData);
 }
 
 
@@ -10,11 +10,11 @@
 
 using namespace std::chrono_literals;
 
-extern "C" JNIEXPORT jboolean JNICALL Java_io_boden_android_NativeDispatcher_nativeTimerEvent(JNIEnv *env,
-                                                                                              jclass rawClass,
-                                                                                              jobject rawTimerObject)
+extern "C" JNIEXPORT jdouble JNICALL Java_io_boden_android_NativeDispatcher_nativeTimerEvent(JNIEnv *env,
+                                                                                             jclass rawClass,
+                                                                                             jobject rawTimerObject)
 {
-    jboolean returnValue = JNI_TRUE;
+    jdouble returnValue = -1;
     bdn::platformEntryWrapper(
         [&]() {
             bdn::java::wrapper::NativeStrongPointer nativePointer(
@@ -23,7 +23,7 @@ extern "C" JNIEXPORT jboolean JNICALL Java_io_boden_android_NativeDispatcher_nat
             auto timer = std::static_pointer_cast<bdn::android::MainDispatcher::Timer_>(nativePointer.getPointer());
 
             if (timer) {
-                returnValue = timer->onEvent() ? JNI_TRUE : JNI_FALSE;
+                returnValue = timer->onEvent();
             }
         },
         true, env);
@@ -42,10 +42,28 @@ namespace bdn::android
 
     void MainDispatcher::newTimed(DispatchQueue::LockType &lk) { scheduleCallAt(DispatchQueue::Clock::now()); }
 
-    void MainDispatcher::createTimerInternal(std::chrono::duration<double> interval, std::function<bool()> timer)
+    DispatchQueue::CancellationToken MainDispatcher::createTimerInternal(std::chrono::duration<double> interval,
+                                                                         TickFunction timer, MissedTickPolicy policy,
+                                                                         Clock::duration leeway)
     {
-        std::shared_ptr<Timer_> nativeTimer = std::make_shared<Timer_>(timer);
-        _nativeDispatcher.createTimer(interval, nativeTimer);
+        auto nativeTimer = std::make_shared<Timer_>(
+            std::move(timer), std::chrono::duration_cast<Clock::duration>(interval), policy, leeway);
+
+        uint64_t id = PlatformTimerIdFlag | _nextTimerId++;
+        _nativeDispatcher.createTimer(id, nativeTimer->firstDelay(), nativeTimer);
+
+        return makeCancellationToken(id);
+    }
+
+    bool MainDispatcher::cancelTimed(uint64_t id)
+    {
+        if ((id & PlatformTimerIdFlag) == 0) {
+            return DispatchQueue::cancelTimed(id);
+        }
+
+        // Removes the task from the Java timer right away, so it does not
+        // wake up again. Waits for a call that is running on the main thread.
+        return _nativeDispatcher.cancelTimer(static_cast<int64_t>(id));
     }
 
     void MainDispatcher::scheduleCallAt(TimePoint at)
@@ -60,6 +78,9 @@ namespace bdn::android
         DispatchQueue::LockType lk(queueMutex());
         auto nextTimed = processQueue(lk);
 
+        // processQueue() stops once its budget is spent and asks to be
+        // called again right away. Posting that call instead of looping
+        // here lets the Looper handle input in between.
         if (nextTimed) {
             scheduleCallAt(*nextTimed);
         }
@@ -26,7 +26,9 @@ namespace bdn::fk
       protected:
         void notifyWorker(LockType &lk) override;
         void newTimed(LockType &lk) override;
-        void createTimerInternal(std::chrono::duration<double> interval, std::function<bool()> timer) override;
+        CancellationToken createTimerInternal(std::chrono::duration<double> interval, TickFunction timer,
+                                              MissedTickPolicy policy, Clock::duration leeway) override;
+        bool cancelTimed(uint64_t id) override;
 
       private:
         void scheduleCall();
@@ -34,5 +36,6 @@ namespace bdn::fk
 
       private:
         std::list<std::unique_ptr<DispatchTimer>> _timers;
+        uint64_t _nextTimerId = 0;
     };
 }
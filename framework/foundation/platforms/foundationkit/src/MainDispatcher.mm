@@ -41,12 +41,19 @@ namespace bdn::fk
 
     void MainDispatcher::newTimed(DispatchQueue::LockType &lk) { scheduleCall(); }
 
-    void MainDispatcher::createTimerInternal(std::chrono::duration<double> interval, std::function<bool()> timer)
+    DispatchQueue::CancellationToken MainDispatcher::createTimerInternal(std::chrono::duration<double> interval,
+                                                                         TickFunction timer, MissedTickPolicy policy,
+                                                                         Clock::duration leeway)
     {
         DispatchQueue::LockType lk(queueMutex());
 
+        uint64_t id = PlatformTimerIdFlag | _nextTimerId++;
         auto intervalInNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(interval);
-        _timers.emplace_back(std::make_unique<DispatchTimer>(shared_from_this(), timer, intervalInNanoseconds.count()));
+        auto leewayInNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(leeway);
+        _timers.emplace_back(std::make_unique<DispatchTimer>(shared_from_this(), timer, intervalInNanoseconds.count(),
+                                                             leewayInNanoseconds.count(), policy, id));
+
+        return makeCancellationToken(id);
     }
 
     void MainDispatcher::process()
@@ -76,18 +83,47 @@ namespace bdn::fk
     class DispatchTimer
     {
       public:
-        DispatchTimer(std::weak_ptr<MainDispatcher> dispatcher, std::function<bool()> timer,
-                      long long intervalInNanoseconds)
-            : _dispatcher(dispatcher), _timer(timer)
+        DispatchTimer(std::weak_ptr<MainDispatcher> dispatcher, DispatchQueue::TickFunction timer,
+                      long long intervalInNanoseconds, long long leewayInNanoseconds,
+                      DispatchQueue::MissedTickPolicy policy, uint64_t id)
+            : _dispatcher(dispatcher), _timer(timer), _id(id)
         {
             _source = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_main_queue());
-            dispatch_time_t intervalStart = dispatch_walltime(NULL, intervalInNanoseconds);
 
-            dispatch_source_set_timer(_source, intervalStart, (dispatch_time_t)intervalInNanoseconds,
-                                      10 * 1000 * 1000); // 10 ms leeway
+            // At least 10 ms leeway, as before
+            auto leeway = (uint64_t)std::max(leewayInNanoseconds, 10LL * 1000 * 1000);
+            dispatch_source_set_timer(_source, dispatch_walltime(NULL, intervalInNanoseconds),
+                                      (dispatch_time_t)intervalInNanoseconds, leeway);
+
+            // timer may cancel itself through its token, which destroys this
+            auto alive = _alive;
 
             dispatch_source_set_event_handler(_source, ^{
-              if (!timer()) {
+              // libdispatch keeps the timer on its schedule, coalesces
+              // missed ticks and tells us how many fired
+              auto fired = std::max<unsigned long>(dispatch_source_get_data(_source), 1);
+
+              bool repeat = true;
+              switch (policy) {
+              case DispatchQueue::MissedTickPolicy::Coalesce:
+                  repeat = timer(fired - 1);
+                  break;
+              case DispatchQueue::MissedTickPolicy::CatchUp:
+                  for (unsigned long i = 0; i < fired && repeat && *alive; i++) {
+                      repeat = timer(0);
+                  }
+                  break;
+              case DispatchQueue::MissedTickPolicy::Skip:
+                  repeat = timer(fired - 1);
+                  if (repeat && fired > 1 && *alive) {
+                      // Start the schedule over from now
+                      dispatch_source_set_timer(_source, dispatch_walltime(NULL, intervalInNanoseconds),
+                                                (dispatch_time_t)intervalInNanoseconds, leeway);
+                  }
+                  break;
+              }
+
+              if (!repeat && *alive) {
                   cancel();
               }
             });
@@ -97,8 +133,11 @@ namespace bdn::fk
 
         ~DispatchTimer() { cancel(); }
 
+        uint64_t id() const { return _id; }
+
         void cancel()
         {
+            *_alive = false;
             if (_source) {
                 dispatch_source_cancel(_source);
                 _source = nullptr;
@@ -110,7 +149,28 @@ namespace bdn::fk
 
       private:
         dispatch_source_t _source = nullptr;
+        std::shared_ptr<bool> _alive = std::make_shared<bool>(true);
         std::weak_ptr<MainDispatcher> _dispatcher;
-        std::function<bool()> _timer;
+        DispatchQueue::TickFunction _timer;
+        uint64_t _id;
     };
+
+    bool MainDispatcher::cancelTimed(uint64_t id)
+    {
+        if ((id & PlatformTimerIdFlag) == 0) {
+            return DispatchQueue::cancelTimed(id);
+        }
+
+        DispatchQueue::LockType lk(queueMutex());
+
+        auto it = std::find_if(_timers.begin(), _timers.end(), [id](auto &p) { return p->id() == id; });
+        if (it == _timers.end()) {
+            return false;
+        }
+
+        auto timer = std::move(*it);
+        _timers.erase(it);
+        timer.reset();
+        return true;
+    }
 }
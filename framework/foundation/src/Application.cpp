@@ -48,6 +48,15 @@ namespace bdn
 
     std::shared_ptr<DispatchQueue> Application::dispatchQueue() { return _mainDispatchQueue; }
 
+    std::shared_ptr<ThreadPool> Application::threadPool()
+    {
+        std::unique_lock<std::mutex> lk(_threadPoolMutex);
+        if (!_threadPool) {
+            _threadPool = std::make_shared<ThreadPool>(0, _mainDispatchQueue);
+        }
+        return _threadPool;
+    }
+
     std::shared_ptr<ApplicationController> Application::applicationController() { return _applicationController; }
 
     std::shared_ptr<Application> Application::globalApplication() { return bdn::globalApplication(); }
@@ -79,6 +88,15 @@ namespace bdn
         // get a crash.
         disposeMainDispatcher();
 
+        // Same for the background pool: functions that have not started yet
+        // are discarded, running ones are waited for.
+        std::shared_ptr<ThreadPool> threadPool;
+        {
+            std::unique_lock<std::mutex> lk(_threadPoolMutex);
+            threadPool = std::move(_threadPool);
+        }
+        threadPool.reset();
+
         platformSpecificCleanup();
 
         setGlobalApplication(nullptr);
@@ -0,0 +1,101 @@
+#include <bdn/ConcurrentNotifier.h>
+
+#include <algorithm>
+#include <thread>
+
+namespace bdn
+{
+    namespace detail
+    {
+        namespace
+        {
+            std::atomic<NotifierHazards::Slot *> g_slots{nullptr};
+
+            NotifierHazards::Slot *claimSlot()
+            {
+                for (auto slot = g_slots.load(); slot != nullptr; slot = slot->next) {
+                    bool expected = false;
+                    if (!slot->inUse.load(std::memory_order_relaxed) &&
+                        slot->inUse.compare_exchange_strong(expected, true)) {
+                        return slot;
+                    }
+                }
+
+                auto slot = new NotifierHazards::Slot;
+                slot->inUse.store(true);
+                slot->next = g_slots.load();
+                while (!g_slots.compare_exchange_weak(slot->next, slot)) {
+                }
+                return slot;
+            }
+
+            struct ThreadSlots
+            {
+                ~ThreadSlots()
+                {
+                    for (auto slot : slots) {
+                        slot->inUse.store(false);
+                    }
+                }
+
+                bool owns(const NotifierHazards::Slot *slot) const
+                {
+                    return std::find(slots.begin(), slots.end(), slot) != slots.end();
+                }
+
+                // One per nesting level of notify(), claimed on first use
+                std::vector<NotifierHazards::Slot *> slots;
+                size_t depth = 0;
+            };
+
+            thread_local ThreadSlots t_slots;
+        }
+
+        NotifierHazards::Scope::Scope()
+        {
+            if (t_slots.depth == t_slots.slots.size()) {
+                t_slots.slots.push_back(claimSlot());
+            }
+            _slot = t_slots.slots[t_slots.depth++];
+        }
+
+        NotifierHazards::Scope::~Scope()
+        {
+            _slot->calling.store(nullptr, std::memory_order_release);
+            _slot->snapshot.store(nullptr, std::memory_order_release);
+            t_slots.depth--;
+        }
+
+        bool NotifierHazards::isSnapshotHeld(const void *snapshot)
+        {
+            for (auto slot = g_slots.load(); slot != nullptr; slot = slot->next) {
+                if (slot->snapshot.load() == snapshot) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool NotifierHazards::isCalledOnThisThread(const void *subscriber)
+        {
+            for (size_t i = 0; i < t_slots.depth; i++) {
+                if (t_slots.slots[i]->calling.load(std::memory_order_relaxed) == subscriber) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void NotifierHazards::waitWhileCalledElsewhere(const void *subscriber)
+        {
+            for (auto slot = g_slots.load(); slot != nullptr; slot = slot->next) {
+                if (t_slots.owns(slot)) {
+                    continue;
+                }
+                while (slot->calling.load() == subscriber) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+    }
+}
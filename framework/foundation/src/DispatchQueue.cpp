@@ -0,0 +1,718 @@
+#include <bdn/DispatchQueue.h>
+
+#include <algorithm>
+
+namespace bdn
+{
+    DispatchQueue::DispatchQueue(bool slave, std::shared_ptr<TimeSource> timeSource)
+        : _slave(slave), _timeSource(std::move(timeSource)), _timedQueue(now())
+    {
+        if (_timeSource) {
+            _timeSource->attach(this);
+        }
+
+        if (!_slave) {
+            startWorkerThread();
+        }
+    }
+
+    DispatchQueue::~DispatchQueue()
+    {
+        stopWorkerThread();
+
+        if (_timeSource) {
+            _timeSource->detach(this);
+        }
+    }
+
+    void DispatchQueue::startWorkerThread()
+    {
+        _thread = std::make_unique<std::thread>(std::bind(&DispatchQueue::workerThread, this));
+        _threadId = _thread->get_id();
+    }
+
+    void DispatchQueue::stopWorkerThread()
+    {
+        cancel();
+        if (_thread) {
+            _thread->join();
+            _thread.reset();
+        }
+    }
+
+    void DispatchQueue::enter()
+    {
+        if (_thread) {
+            throw std::logic_error("This queue is already served by its own thread!");
+        }
+        if (_cancelled) {
+            throw std::logic_error("This queue is already cancelled!");
+        }
+
+        _threadId = std::this_thread::get_id();
+
+        workerThread();
+
+        LockType lk(_queueMutex);
+        emptyQueues(lk);
+    }
+
+    void DispatchQueue::cancel()
+    {
+        LockType lk(_queueMutex);
+        _cancelled = true;
+        notifyWorker(lk);
+
+        for (auto waiter = _syncWaiters; waiter != nullptr; waiter = waiter->next) {
+            waiter->condition.notify_one();
+        }
+    }
+
+    void DispatchQueue::executeSync()
+    {
+        if (_thread) {
+            throw std::logic_error("This queue is already served by its own thread!");
+        }
+
+        LockType lk(_queueMutex);
+        executeNext(lk);
+    }
+
+    bool DispatchQueue::dispatchAsyncCoalesced(CoalesceKey key, Function function, Priority priority,
+                                               SourceTag source)
+    {
+        {
+            LockType lk(_queueMutex);
+            if (_cancelled) {
+                return false;
+            }
+
+            // The lane only holds a stub that looks up the key when it runs,
+            // so replacing the function never has to touch the lane.
+            auto [it, inserted] = _coalesced.try_emplace(key);
+            // Swapped rather than assigned so that the replaced function is
+            // destroyed after the lock was released.
+            std::swap(it->second, function);
+            if (!inserted) {
+                return false;
+            }
+        }
+
+        dispatchAsync([this, key]() { runCoalesced(key); }, priority, source);
+        return true;
+    }
+
+    void DispatchQueue::runCoalesced(CoalesceKey key)
+    {
+        Function function;
+        {
+            LockType lk(_queueMutex);
+            auto it = _coalesced.find(key);
+            if (it == _coalesced.end()) {
+                return;
+            }
+            function = std::move(it->second);
+            _coalesced.erase(it);
+        }
+
+        // Posts from here on queue a new stub, even from within function
+        function();
+    }
+
+    DispatchQueue::CancellationToken DispatchQueue::createTimerInternal(std::chrono::duration<double> interval,
+                                                                        TickFunction timer, MissedTickPolicy policy,
+                                                                        Clock::duration leeway)
+    {
+        LockType lk(_queueMutex);
+
+        auto intervalDuration = std::chrono::duration_cast<Clock::duration>(interval);
+        auto deadline = now() + intervalDuration;
+        auto handle = _timedQueue.insert(
+            coalesce(deadline, leeway),
+            TimedTask{nullptr, std::move(timer), intervalDuration, deadline, Priority::Default, leeway, policy});
+        newTimed(lk);
+#ifdef BDN_DISPATCH_INSTRUMENTATION
+        recordTimedDepth(lk);
+#endif
+        notifyWorker(lk);
+
+        return CancellationToken(this, handle.id());
+    }
+
+    DispatchQueue::CancellationToken DispatchQueue::dispatchWhenIdle(IdleFunction function,
+                                                                     std::optional<Clock::duration> deadlineHint)
+    {
+        LockType lk(_queueMutex);
+
+        std::optional<TimePoint> deadline;
+        if (deadlineHint) {
+            deadline = now() + *deadlineHint;
+        }
+
+        uint64_t id = IdleIdFlag | _nextIdleId++;
+        _idleTasks.push_back(IdleTask{std::move(function), deadline, id});
+
+        // Like a new timed task the worker has to reconsider when to wake up
+        newTimed(lk);
+        notifyWorker(lk);
+
+        return CancellationToken(this, id);
+    }
+
+    bool DispatchQueue::cancelTimed(uint64_t id)
+    {
+        LockType lk(_queueMutex);
+
+        if ((id & IdleIdFlag) != 0) {
+            auto it = std::find_if(_idleTasks.begin(), _idleTasks.end(), [id](auto &task) { return task.id == id; });
+            if (it == _idleTasks.end()) {
+                return false;
+            }
+            _idleTasks.erase(it);
+            return true;
+        }
+
+        return _timedQueue.cancel(TimedQueue::Handle::fromId(id));
+    }
+
+    void DispatchQueue::completeSyncWaiter(SyncWaiter &waiter)
+    {
+        LockType lk(_queueMutex);
+        waiter.done = true;
+        waiter.condition.notify_one();
+    }
+
+    void DispatchQueue::waitForSyncWaiter(SyncWaiter &waiter)
+    {
+        // Most sync dispatches are short. Giving the worker a chance to run
+        // first avoids blocking on the condition variable entirely.
+        for (int i = 0; i < SyncSpinCount && !waiter.done.load(std::memory_order_acquire); i++) {
+            std::this_thread::yield();
+        }
+
+        LockType lk(_queueMutex);
+        if (waiter.done) {
+            // Taking the lock made sure completeSyncWaiter() is done with us
+            return;
+        }
+
+        // The list is only needed so that cancel() can wake us up, the task
+        // itself only ever touches the waiter directly.
+        waiter.next = _syncWaiters;
+        if (_syncWaiters != nullptr) {
+            _syncWaiters->previous = &waiter;
+        }
+        _syncWaiters = &waiter;
+
+        // Once the queue is cancelled no further task is started. If nothing
+        // is executing at that point our task will never run and we can
+        // return without it touching our stack afterwards.
+        waiter.condition.wait(lk, [&]() { return waiter.done || (_cancelled && _executing == 0); });
+
+        if (waiter.previous != nullptr) {
+            waiter.previous->next = waiter.next;
+        } else {
+            _syncWaiters = waiter.next;
+        }
+        if (waiter.next != nullptr) {
+            waiter.next->previous = waiter.previous;
+        }
+    }
+
+    void DispatchQueue::setProcessBudget(Clock::duration budget)
+    {
+        LockType lk(_queueMutex);
+        _processBudget = budget;
+    }
+
+    DispatchQueue::Clock::duration DispatchQueue::processBudget()
+    {
+        LockType lk(_queueMutex);
+        return _processBudget;
+    }
+
+    DispatchQueue::ProcessMetrics DispatchQueue::processMetrics()
+    {
+        LockType lk(_queueMutex);
+        return _processMetrics;
+    }
+
+    void DispatchQueue::resetProcessMetrics()
+    {
+        LockType lk(_queueMutex);
+        _processMetrics = ProcessMetrics{};
+    }
+
+    DispatchQueue::WaitMetrics DispatchQueue::waitMetrics(Priority priority)
+    {
+        LockType lk(_queueMutex);
+        return _waitMetrics[static_cast<size_t>(priority)];
+    }
+
+    void DispatchQueue::resetWaitMetrics()
+    {
+        LockType lk(_queueMutex);
+        _waitMetrics.fill(WaitMetrics{});
+    }
+
+    DispatchQueue::Statistics DispatchQueue::statistics()
+    {
+#ifdef BDN_DISPATCH_INSTRUMENTATION
+        LockType lk(_queueMutex);
+        Statistics result = _statistics;
+        result.depth = queuedCount();
+        result.maxDepth = std::max(_maxDepth.load(std::memory_order_relaxed), result.depth);
+        result.timedDepth = _timedQueue.size();
+        return result;
+#else
+        return Statistics{};
+#endif
+    }
+
+    void DispatchQueue::resetStatistics()
+    {
+#ifdef BDN_DISPATCH_INSTRUMENTATION
+        LockType lk(_queueMutex);
+        _statistics = Statistics{};
+        _statistics.maxTimedDepth = _timedQueue.size();
+        _maxDepth = queuedCount();
+#endif
+    }
+
+    void DispatchQueue::setSlowTaskHandler(Clock::duration threshold, std::function<void(const SlowTask &)> handler)
+    {
+#ifdef BDN_DISPATCH_INSTRUMENTATION
+        LockType lk(_queueMutex);
+        _slowTaskThreshold = threshold;
+        _slowTaskHandler = std::move(handler);
+#endif
+    }
+
+#ifdef BDN_DISPATCH_INSTRUMENTATION
+    void DispatchQueue::recordDepth()
+    {
+        auto depth = queuedCount();
+        auto max = _maxDepth.load(std::memory_order_relaxed);
+        while (depth > max && !_maxDepth.compare_exchange_weak(max, depth, std::memory_order_relaxed)) {
+        }
+    }
+
+    void DispatchQueue::recordTimedDepth(LockType &lk)
+    {
+        _statistics.maxTimedDepth = std::max(_statistics.maxTimedDepth, _timedQueue.size());
+    }
+
+    void DispatchQueue::recordRun(LockType &lk, const SlowTask &task)
+    {
+        _statistics.runTime.record(task.runTime);
+
+        if (!_slowTaskHandler || task.runTime < _slowTaskThreshold) {
+            return;
+        }
+
+        _statistics.slowTasks++;
+
+        // Copied so that the handler may replace itself
+        auto handler = _slowTaskHandler;
+        lk.unlock();
+        handler(task);
+        lk.lock();
+    }
+#endif
+
+    size_t DispatchQueue::queuedCount() const
+    {
+        size_t count = 0;
+        for (auto &lane : _lanes) {
+            count += static_cast<size_t>(lane.size());
+        }
+        return count;
+    }
+
+    uint64_t DispatchQueue::missedTicks(TimePoint deadline, Clock::duration interval, MissedTickPolicy policy,
+                                        TimePoint called)
+    {
+        if (interval <= Clock::duration::zero() || policy == MissedTickPolicy::CatchUp) {
+            return 0;
+        }
+        if (called - deadline < interval) {
+            return 0;
+        }
+        return static_cast<uint64_t>((called - deadline) / interval);
+    }
+
+    DispatchQueue::TimePoint DispatchQueue::nextTick(TimePoint deadline, Clock::duration interval,
+                                                     MissedTickPolicy policy, TimePoint called, uint64_t missedTicks)
+    {
+        if (interval <= Clock::duration::zero()) {
+            return called;
+        }
+
+        switch (policy) {
+        case MissedTickPolicy::Skip:
+            if (missedTicks > 0) {
+                return called + interval;
+            }
+            break;
+        case MissedTickPolicy::Coalesce:
+        case MissedTickPolicy::CatchUp:
+            // A CatchUp timer that is behind gets a deadline in the past and
+            // is simply popped again right away.
+            break;
+        }
+        return deadline + interval * static_cast<Clock::rep>(missedTicks + 1);
+    }
+
+    DispatchQueue::TimePoint DispatchQueue::coalesce(TimePoint deadline, Clock::duration leeway)
+    {
+        // Deadlines are moved up to the next multiple of the largest power
+        // of two milliseconds that fits into leeway. Everything that lands
+        // on the same multiple expires in the same pass, and the coarser
+        // the grid, the more windows share a point.
+        auto ticks = std::chrono::duration_cast<std::chrono::milliseconds>(leeway).count();
+        if (ticks <= 1) {
+            return deadline;
+        }
+
+        std::chrono::milliseconds::rep gridTicks = 1;
+        while (gridTicks <= ticks / 2) {
+            gridTicks *= 2;
+        }
+        auto grid = std::chrono::duration_cast<Clock::duration>(std::chrono::milliseconds(gridTicks));
+
+        auto sinceEpoch = deadline.time_since_epoch();
+        auto cells = (sinceEpoch + grid - Clock::duration(1)) / grid;
+        return TimePoint(cells * grid);
+    }
+
+    bool DispatchQueue::lanesEmpty() const
+    {
+        return std::all_of(_lanes.begin(), _lanes.end(), [](auto &lane) { return lane.empty(); });
+    }
+
+    bool DispatchQueue::popNext(QueuedTask &task, TimePoint now, size_t &laneIndex)
+    {
+        // Starving lanes first
+        const std::array<std::pair<Priority, Clock::duration>, 2> aging{
+            {{Priority::Default, DefaultAging}, {Priority::Background, BackgroundAging}}};
+        for (auto &[priority, threshold] : aging) {
+            auto oldest = lane(priority).front();
+            if (oldest != nullptr && now - oldest->enqueued >= threshold && lane(priority).pop(task)) {
+                laneIndex = static_cast<size_t>(priority);
+                return true;
+            }
+        }
+
+        for (laneIndex = 0; laneIndex < PriorityCount; laneIndex++) {
+            if (_lanes[laneIndex].pop(task)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool DispatchQueue::executeNext(LockType &lk)
+    {
+        if (_cancelled) {
+            return false;
+        }
+
+        auto current = now();
+        QueuedTask next;
+        size_t laneIndex = 0;
+        if (!popNext(next, current, laneIndex)) {
+            return false;
+        }
+
+        auto &metrics = _waitMetrics[laneIndex];
+        auto waited = std::max(Clock::duration{}, current - next.enqueued);
+        metrics.count++;
+        metrics.total += waited;
+        metrics.max = std::max(metrics.max, waited);
+
+#ifdef BDN_DISPATCH_INSTRUMENTATION
+        _statistics.waitTime.record(waited);
+#endif
+
+        _executing++;
+        lk.unlock();
+        next.function();
+        next.function = nullptr;
+#ifdef BDN_DISPATCH_INSTRUMENTATION
+        auto runTime = now() - current;
+#endif
+        lk.lock();
+        _executing--;
+
+#ifdef BDN_DISPATCH_INSTRUMENTATION
+        recordRun(lk, SlowTask{next.source, static_cast<Priority>(laneIndex), waited, runTime});
+#endif
+
+        if (_cancelled && _executing == 0) {
+            for (auto waiter = _syncWaiters; waiter != nullptr; waiter = waiter->next) {
+                waiter->condition.notify_one();
+            }
+        }
+
+        return true;
+    }
+
+    std::optional<DispatchQueue::TimePoint> DispatchQueue::processTimed(LockType &lk,
+                                                                         std::optional<TimePoint> budgetEnd,
+                                                                         bool &exhausted)
+    {
+        TimedTask task;
+        while (!_cancelled) {
+            auto current = now();
+            if (budgetEnd && current >= *budgetEnd) {
+                // Whatever is left is overdue, nextDeadline() says so
+                exhausted = true;
+                break;
+            }
+
+            auto handle = _timedQueue.popExpired(current, task);
+            if (!handle) {
+                break;
+            }
+
+            if (!task.timer) {
+                // Delayed functions compete with everything else in their lane
+#ifdef BDN_DISPATCH_INSTRUMENTATION
+                lane(task.priority).push(makeQueuedTask(std::move(task.function), task.deadline, task.source));
+#else
+                lane(task.priority).push(makeQueuedTask(std::move(task.function), task.deadline, {}));
+#endif
+                task = TimedTask{};
+                _timedQueue.finish(*handle);
+                continue;
+            }
+
+            auto started = now();
+            auto missed = missedTicks(task.deadline, task.interval, task.policy, started);
+
+            lk.unlock();
+            bool repeat = task.timer(missed);
+            if (!repeat) {
+                task = TimedTask{};
+            }
+            lk.lock();
+
+#ifdef BDN_DISPATCH_INSTRUMENTATION
+            recordRun(lk, SlowTask{{}, Priority::Default, {}, now() - started});
+#endif
+
+            if (repeat) {
+                task.deadline = nextTick(task.deadline, task.interval, task.policy, started, missed);
+                auto key = coalesce(task.deadline, task.leeway);
+                _timedQueue.reschedule(*handle, key, std::move(task));
+            } else {
+                _timedQueue.finish(*handle);
+            }
+        }
+
+        return _timedQueue.nextDeadline();
+    }
+
+    std::optional<DispatchQueue::TimePoint> DispatchQueue::queueOverdueIdle(TimePoint now)
+    {
+        std::optional<TimePoint> earliest;
+        for (auto it = _idleTasks.begin(); it != _idleTasks.end();) {
+            if (!it->deadline) {
+                ++it;
+            } else if (*it->deadline <= now) {
+                auto deadline = *it->deadline;
+                lane(Priority::Default)
+                    .push(makeQueuedTask(
+                        [function = std::move(it->function), deadline, timeSource = _timeSource.get()]() mutable {
+                            function(IdleDeadline{deadline, true, timeSource});
+                        },
+                        deadline, {}));
+                it = _idleTasks.erase(it);
+            } else {
+                earliest = earliest ? std::min(*earliest, *it->deadline) : *it->deadline;
+                ++it;
+            }
+        }
+        return earliest;
+    }
+
+    void DispatchQueue::processIdle(LockType &lk, std::optional<TimePoint> budgetEnd)
+    {
+        auto current = now();
+        auto end = current + MaxIdlePeriod;
+        if (budgetEnd) {
+            end = std::min(end, *budgetEnd);
+        }
+        if (auto nextTimed = _timedQueue.nextDeadline()) {
+            end = std::min(end, *nextTimed);
+        }
+
+        // Anything that gets queued meanwhile ends the idle period
+        while (!_cancelled && !_idleTasks.empty() && lanesEmpty() && end - current >= MinIdlePeriod) {
+            auto task = std::move(_idleTasks.front());
+            _idleTasks.pop_front();
+
+            lk.unlock();
+            task.function(IdleDeadline{end, false, _timeSource.get()});
+            task.function = nullptr;
+            lk.lock();
+
+            current = now();
+        }
+    }
+
+    std::optional<DispatchQueue::TimePoint> DispatchQueue::processQueue(LockType &lk)
+    {
+#ifdef BDN_DISPATCH_INSTRUMENTATION
+        _statistics.wakeups++;
+#endif
+
+        auto passStart = now();
+        std::optional<TimePoint> budgetEnd;
+        if (_processBudget > Clock::duration::zero()) {
+            budgetEnd = passStart + _processBudget;
+        }
+
+        bool exhausted = false;
+        auto nextTimed = processTimed(lk, budgetEnd, exhausted);
+        auto nextIdleDeadline = _idleTasks.empty() ? std::nullopt : queueOverdueIdle(passStart);
+
+        // At least one function runs per pass, even if the timers used up
+        // the budget, so that neither side can starve the other.
+        while (executeNext(lk)) {
+            auto current = now();
+            if (nextTimed && current >= *nextTimed) {
+                break;
+            }
+            if (budgetEnd && current >= *budgetEnd) {
+                exhausted = true;
+                break;
+            }
+        }
+
+        if (!_cancelled && !_idleTasks.empty() && lanesEmpty()) {
+            processIdle(lk, budgetEnd);
+        }
+
+        _processMetrics.passes++;
+        if (exhausted) {
+            _processMetrics.budgetExhausted++;
+        }
+        _processMetrics.longestPass = std::max(_processMetrics.longestPass, now() - passStart);
+
+        if (!_cancelled && !lanesEmpty()) {
+            // We yielded to the timed queue, ran out of budget or a producer
+            // has not finished linking its task yet. Either way we want to
+            // be called again right away, after the caller had a chance to
+            // handle its own events.
+            return now();
+        }
+
+        if (!_cancelled && !_idleTasks.empty()) {
+            // The idle period ended early. Try again shortly, or at a
+            // deadline of one of the remaining idle functions.
+            auto retry = now() + MinIdlePeriod;
+            if (nextIdleDeadline) {
+                retry = std::min(retry, *nextIdleDeadline);
+            }
+            return nextTimed ? std::min(*nextTimed, retry) : retry;
+        }
+
+        return nextTimed;
+    }
+
+    std::optional<DispatchQueue::TimePoint> DispatchQueue::nextDue()
+    {
+        LockType lk(_queueMutex);
+        if (_cancelled) {
+            return std::nullopt;
+        }
+        if (!lanesEmpty()) {
+            return now();
+        }
+
+        auto next = _timedQueue.nextDeadline();
+        for (auto &task : _idleTasks) {
+            if (task.deadline) {
+                next = next ? std::min(*next, *task.deadline) : *task.deadline;
+            }
+        }
+        return next;
+    }
+
+    void DispatchQueue::processDue()
+    {
+        if (_threadId == std::thread::id() || std::this_thread::get_id() == _threadId) {
+            // Nobody serves the queue, or we are it
+            LockType lk(_queueMutex);
+            while (!_cancelled) {
+                auto next = processQueue(lk);
+                if (!next || *next > now()) {
+                    break;
+                }
+            }
+            return;
+        }
+
+        // The worker runs everything that is due before it gets to the
+        // Background barrier, unless time moved on while it was busy.
+        do {
+            {
+                LockType lk(_queueMutex);
+                newTimed(lk);
+                notifyWorker(lk);
+            }
+            dispatchSync([]() {}, Priority::Background);
+            auto next = nextDue();
+            if (!next || *next > now()) {
+                break;
+            }
+        } while (!_cancelled);
+    }
+
+    void DispatchQueue::emptyQueues(LockType &lk)
+    {
+        for (auto &lane : _lanes) {
+            lane.clear();
+        }
+        _timedQueue.clear();
+        _coalesced.clear();
+        _idleTasks.clear();
+    }
+
+    void DispatchQueue::waitForWork(LockType &lk, std::optional<TimePoint> until)
+    {
+        int oldTimed = _nTimed;
+        auto hasWork = [&]() { return _cancelled || !lanesEmpty() || _nTimed != oldTimed; };
+
+        if (until) {
+            _notification.wait_until(lk, *until, hasWork);
+        } else {
+            _notification.wait(lk, hasWork);
+        }
+    }
+
+    void DispatchQueue::workerThread()
+    {
+        LockType lk(_queueMutex);
+        while (true) {
+            if (_cancelled) {
+                return;
+            }
+
+            auto nextTimed = processQueue(lk);
+
+            if (!lanesEmpty()) {
+                lk.unlock();
+                std::this_thread::yield();
+                lk.lock();
+                continue;
+            }
+
+            if (_timeSource && _timeSource->isVirtual()) {
+                nextTimed = std::nullopt;
+            }
+            waitForWork(lk, nextTimed);
+        }
+    }
+}
@@ -0,0 +1,224 @@
+#if defined(__linux__)
+
+#include <bdn/EpollDispatchQueue.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <system_error>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+namespace bdn
+{
+    namespace
+    {
+        int checked(int result, const char *what)
+        {
+            if (result < 0) {
+                throw std::system_error(errno, std::system_category(), what);
+            }
+            return result;
+        }
+
+        uint32_t toEpollEvents(uint32_t events)
+        {
+            uint32_t result = 0;
+            if ((events & EpollDispatchQueue::Readable) != 0) {
+                result |= EPOLLIN | EPOLLRDHUP;
+            }
+            if ((events & EpollDispatchQueue::Writable) != 0) {
+                result |= EPOLLOUT;
+            }
+            if ((events & EpollDispatchQueue::EdgeTriggered) != 0) {
+                result |= EPOLLET;
+            }
+            return result;
+        }
+
+        uint32_t fromEpollEvents(uint32_t events)
+        {
+            uint32_t result = 0;
+            if ((events & EPOLLIN) != 0) {
+                result |= EpollDispatchQueue::Readable;
+            }
+            if ((events & EPOLLOUT) != 0) {
+                result |= EpollDispatchQueue::Writable;
+            }
+            if ((events & EPOLLERR) != 0) {
+                result |= EpollDispatchQueue::Error;
+            }
+            if ((events & (EPOLLHUP | EPOLLRDHUP)) != 0) {
+                result |= EpollDispatchQueue::HangUp;
+            }
+            return result;
+        }
+
+        void add(int epollFd, int fd, uint64_t tag)
+        {
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.u64 = tag;
+            checked(epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event), "epoll_ctl");
+        }
+
+        void drain(int fd)
+        {
+            uint64_t value = 0;
+            while (read(fd, &value, sizeof(value)) > 0) {
+            }
+        }
+    }
+
+    EpollDispatchQueue::EpollDispatchQueue(bool slave, std::shared_ptr<TimeSource> timeSource)
+        : DispatchQueue(true, std::move(timeSource))
+    {
+        try {
+            _epollFd = checked(epoll_create1(EPOLL_CLOEXEC), "epoll_create1");
+            _wakeupFd = checked(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC), "eventfd");
+            _timerFd = checked(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC), "timerfd_create");
+            add(_epollFd, _wakeupFd, WakeupTag);
+            add(_epollFd, _timerFd, TimerTag);
+        }
+        catch (...) {
+            for (int fd : {_epollFd, _wakeupFd, _timerFd}) {
+                if (fd >= 0) {
+                    close(fd);
+                }
+            }
+            throw;
+        }
+
+        // The base class' thread would start waiting before we are
+        // constructed
+        if (!slave) {
+            startWorkerThread();
+        }
+    }
+
+    EpollDispatchQueue::~EpollDispatchQueue()
+    {
+        stopWorkerThread();
+
+        close(_timerFd);
+        close(_wakeupFd);
+        close(_epollFd);
+    }
+
+    void EpollDispatchQueue::watchFd(int fd, uint32_t events, FdCallback callback)
+    {
+        std::lock_guard<std::mutex> lk(_watchMutex);
+
+        auto [it, inserted] = _watches.try_emplace(fd);
+        auto generation = _nextGeneration++;
+
+        // The generation tells events of a replaced or removed watch apart
+        // from those of a new one that reuses the fd.
+        epoll_event event{};
+        event.events = toEpollEvents(events);
+        event.data.u64 = (uint64_t(generation) << 32) | static_cast<uint32_t>(fd);
+
+        if (epoll_ctl(_epollFd, inserted ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &event) < 0) {
+            auto error = errno;
+            if (inserted) {
+                _watches.erase(it);
+            }
+            throw std::system_error(error, std::system_category(), "epoll_ctl");
+        }
+
+        it->second = Watch{generation, std::make_shared<FdCallback>(std::move(callback))};
+    }
+
+    bool EpollDispatchQueue::unwatchFd(int fd)
+    {
+        std::lock_guard<std::mutex> lk(_watchMutex);
+
+        auto it = _watches.find(fd);
+        if (it == _watches.end()) {
+            return false;
+        }
+        _watches.erase(it);
+
+        // Fails if fd was closed already, which removed it from the set
+        epoll_ctl(_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        return true;
+    }
+
+    void EpollDispatchQueue::notifyWorker(LockType &lk)
+    {
+        uint64_t one = 1;
+        // Only fails if the counter is about to overflow, the worker is
+        // awake in that case anyway.
+        [[maybe_unused]] auto written = write(_wakeupFd, &one, sizeof(one));
+    }
+
+    void EpollDispatchQueue::waitForWork(LockType &lk, std::optional<TimePoint> until)
+    {
+        armTimer(until);
+
+        lk.unlock();
+
+        std::array<epoll_event, MaxEventsPerWait> events{};
+        int count = 0;
+        do {
+            count = epoll_wait(_epollFd, events.data(), MaxEventsPerWait, -1);
+        } while (count < 0 && errno == EINTR);
+
+        for (int i = 0; i < count; i++) {
+            auto tag = events[i].data.u64;
+            if (tag == WakeupTag) {
+                drain(_wakeupFd);
+            } else if (tag == TimerTag) {
+                drain(_timerFd);
+                _armedFor.reset();
+            } else {
+                dispatchFd(tag, events[i].events);
+            }
+        }
+
+        lk.lock();
+    }
+
+    void EpollDispatchQueue::armTimer(std::optional<TimePoint> until)
+    {
+        if (until == _armedFor) {
+            return;
+        }
+        _armedFor = until;
+
+        itimerspec spec{};
+        if (until) {
+            // steady_clock is CLOCK_MONOTONIC. A zero it_value would disarm
+            // the timer, anything in the past fires right away.
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(until->time_since_epoch()).count();
+            ns = std::max<decltype(ns)>(ns, 1);
+            spec.it_value.tv_sec = static_cast<time_t>(ns / 1000000000);
+            spec.it_value.tv_nsec = static_cast<long>(ns % 1000000000);
+        }
+        checked(timerfd_settime(_timerFd, TFD_TIMER_ABSTIME, &spec, nullptr), "timerfd_settime");
+    }
+
+    void EpollDispatchQueue::dispatchFd(uint64_t tag, uint32_t epollEvents)
+    {
+        auto fd = static_cast<int>(tag & UINT32_MAX);
+        auto generation = static_cast<uint32_t>(tag >> 32);
+
+        std::shared_ptr<FdCallback> callback;
+        {
+            std::lock_guard<std::mutex> lk(_watchMutex);
+            auto it = _watches.find(fd);
+            if (it == _watches.end() || it->second.generation != generation) {
+                return;
+            }
+            callback = it->second.callback;
+        }
+
+        (*callback)(fd, fromEpollEvents(epollEvents));
+    }
+}
+
+#endif
@@ -0,0 +1,55 @@
+#include <bdn/Application.h>
+#include <bdn/SerialQueue.h>
+
+#include <algorithm>
+
+namespace bdn
+{
+    namespace
+    {
+        thread_local const SerialQueue *t_currentSerialQueue = nullptr;
+    }
+
+    SerialQueue::SerialQueue(std::shared_ptr<ThreadPool> pool, size_t batchSize)
+        : _pool(std::move(pool)), _batchSize(std::max<size_t>(1, batchSize))
+    {
+        if (!_pool) {
+            _pool = App()->threadPool();
+        }
+    }
+
+    bool SerialQueue::isCurrent() const { return t_currentSerialQueue == this; }
+
+    void SerialQueue::dispatchAsync(Function function)
+    {
+        _functions.push(std::move(function));
+
+        if (_pending.fetch_add(1) == 0) {
+            _pool->dispatchAsync([self = shared_from_this()]() { self->drain(); });
+        }
+    }
+
+    void SerialQueue::drain()
+    {
+        auto previous = t_currentSerialQueue;
+        t_currentSerialQueue = this;
+
+        // A producer may have counted its function but not linked it yet, so
+        // fewer than _pending might be available.
+        size_t ran = 0;
+        Function function;
+        while (ran < _batchSize && _functions.pop(function)) {
+            function();
+            function = nullptr;
+            ran++;
+        }
+
+        t_currentSerialQueue = previous;
+
+        // Anything left continues in a new job, which other workers may steal
+        // while this one moves on to other work.
+        if (_pending.fetch_sub(ran) != ran) {
+            _pool->dispatchAsync([self = shared_from_this()]() { self->drain(); });
+        }
+    }
+}
@@ -0,0 +1,238 @@
+#include <bdn/ThreadPool.h>
+
+#include <exception>
+
+namespace bdn
+{
+    namespace
+    {
+        struct CurrentWorker
+        {
+            const ThreadPool *pool = nullptr;
+            void *worker = nullptr;
+            size_t stealOffset = 0;
+        };
+
+        thread_local CurrentWorker t_currentWorker;
+    }
+
+    ThreadPool::ThreadPool(size_t threadCount, std::shared_ptr<DispatchQueue> completionQueue)
+        : _completionQueue(completionQueue)
+    {
+        if (threadCount == 0) {
+            threadCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+        }
+
+        _workers.reserve(threadCount);
+        for (size_t i = 0; i < threadCount; i++) {
+            _workers.push_back(std::make_unique<Worker>());
+        }
+
+        // Only start the threads once _workers does not change anymore
+        for (size_t i = 0; i < threadCount; i++) {
+            _workers[i]->thread = std::thread(&ThreadPool::workerThread, this, i);
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::unique_lock<std::mutex> lk(_mutex);
+            _stopped = true;
+            _wakeup.notify_all();
+        }
+
+        for (auto &worker : _workers) {
+            if (worker.get() == currentWorker()) {
+                // The last reference was dropped by one of our own functions.
+                // workerThread() notices and returns without touching us.
+                worker->thread.detach();
+                t_currentWorker = CurrentWorker{};
+            } else {
+                worker->thread.join();
+            }
+        }
+
+        Job *job = nullptr;
+        for (auto &worker : _workers) {
+            while (worker->deque.pop(job)) {
+                delete job;
+            }
+        }
+        for (auto injected : _injected) {
+            delete injected;
+        }
+    }
+
+    bool ThreadPool::isWorkerThread() const { return currentWorker() != nullptr; }
+
+    ThreadPool::Worker *ThreadPool::currentWorker() const
+    {
+        if (t_currentWorker.pool != this) {
+            return nullptr;
+        }
+        return static_cast<Worker *>(t_currentWorker.worker);
+    }
+
+    void ThreadPool::dispatchAsync(Function function)
+    {
+        if (_stopped) {
+            return;
+        }
+
+        auto job = new Job{std::move(function)};
+
+        // Counted before the job becomes visible so that _pending never drops
+        // below zero. Pairs with the increment of _sleeping in workerThread():
+        // either we see the sleeper or it sees the new job before sleeping.
+        _pending.fetch_add(1);
+
+        if (auto worker = currentWorker()) {
+            worker->deque.push(job);
+        } else {
+            std::unique_lock<std::mutex> lk(_mutex);
+            _injected.push_back(job);
+        }
+
+        if (_sleeping.load() > 0) {
+            std::unique_lock<std::mutex> lk(_mutex);
+            _wakeup.notify_one();
+        }
+    }
+
+    void ThreadPool::runChunks(size_t chunkCount, const std::function<void(size_t)> &chunk)
+    {
+        // Helper jobs may start long after we returned, or never if the pool
+        // is stopping, so they share this state instead of using our stack.
+        // They only call chunk for an index they claimed, and we wait for
+        // every claimed chunk before returning.
+        struct State
+        {
+            const std::function<void(size_t)> *chunk;
+            size_t chunkCount;
+            std::atomic<size_t> nextChunk{0};
+            std::atomic<bool> failed{false};
+            std::exception_ptr error;
+
+            std::atomic<size_t> finishedCount{0};
+            std::mutex mutex;
+            std::condition_variable finished;
+
+            // Claims chunks until none are left. Once a chunk failed the
+            // remaining ones are claimed and skipped.
+            void drain()
+            {
+                size_t index;
+                while ((index = nextChunk.fetch_add(1)) < chunkCount) {
+                    std::exception_ptr chunkError;
+                    if (!failed.load(std::memory_order_relaxed)) {
+                        try {
+                            (*chunk)(index);
+                        }
+                        catch (...) {
+                            chunkError = std::current_exception();
+                            failed = true;
+                        }
+                    }
+
+                    if (chunkError) {
+                        std::unique_lock<std::mutex> lk(mutex);
+                        if (!error) {
+                            error = chunkError;
+                        }
+                    }
+                    if (finishedCount.fetch_add(1) + 1 == chunkCount) {
+                        std::unique_lock<std::mutex> lk(mutex);
+                        finished.notify_all();
+                    }
+                }
+            }
+        };
+
+        auto state = std::make_shared<State>();
+        state->chunk = &chunk;
+        state->chunkCount = chunkCount;
+
+        size_t helperCount = std::min(chunkCount - 1, threadCount());
+        for (size_t i = 0; i < helperCount; i++) {
+            dispatchAsync([state]() { state->drain(); });
+        }
+
+        // Whatever the helpers did not claim runs right here, so this also
+        // completes if the pool dropped them.
+        state->drain();
+
+        // Only chunks that already run on other threads are left. Waiting for
+        // them instead of running other jobs keeps the caller from being
+        // blocked by unrelated work. Those chunks never wait for us, so
+        // nested calls cannot deadlock.
+        std::unique_lock<std::mutex> lk(state->mutex);
+        state->finished.wait(lk, [&]() { return state->finishedCount == chunkCount; });
+
+        if (state->error) {
+            std::rethrow_exception(state->error);
+        }
+    }
+
+    ThreadPool::Job *ThreadPool::findJob(Worker *self)
+    {
+        Job *job = nullptr;
+
+        if (self != nullptr && self->deque.pop(job)) {
+            return job;
+        }
+
+        {
+            std::unique_lock<std::mutex> lk(_mutex);
+            if (!_injected.empty()) {
+                job = _injected.front();
+                _injected.pop_front();
+                return job;
+            }
+        }
+
+        size_t count = _workers.size();
+        size_t offset = t_currentWorker.stealOffset++;
+        for (size_t i = 0; i < count; i++) {
+            auto &victim = _workers[(offset + i) % count];
+            if (victim.get() != self && victim->deque.steal(job)) {
+                return job;
+            }
+        }
+
+        return nullptr;
+    }
+
+    void ThreadPool::run(Job *job)
+    {
+        _pending.fetch_sub(1);
+        job->function();
+        delete job;
+    }
+
+    void ThreadPool::workerThread(size_t index)
+    {
+        Worker *self = _workers[index].get();
+        t_currentWorker.pool = this;
+        t_currentWorker.worker = self;
+        t_currentWorker.stealOffset = index + 1;
+
+        while (!_stopped) {
+            if (Job *job = findJob(self)) {
+                run(job);
+                if (t_currentWorker.pool != this) {
+                    // The pool was destroyed by the job
+                    return;
+                }
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lk(_mutex);
+            _sleeping.fetch_add(1);
+            _wakeup.wait(lk, [&]() { return _stopped || _pending.load() > 0; });
+            _sleeping.fetch_sub(1);
+        }
+
+        t_currentWorker = CurrentWorker{};
+    }
+}
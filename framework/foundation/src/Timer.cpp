@@ -75,6 +75,12 @@ namespace bdn
             }
         };
 
+        tolerance.onChange() += [this](auto) {
+            if (running.get()) {
+                restart();
+            }
+        };
+
         repeat.onChange() += [this](auto &property) {
             if (property.get()) {
                 if (_isRunning && running) {
@@ -97,13 +103,16 @@ namespace bdn
     void Timer::start()
     {
         if (!_isRunning) {
+            auto leeway = std::chrono::duration_cast<DispatchQueue::Clock::duration>(tolerance.get());
             if (!repeat) {
                 TimerCallback tc(_impl, ++_id);
-                _dispatchQueue->dispatchAsyncDelayed(
-                    std::chrono::duration_cast<std::chrono::milliseconds>(interval.get()), [tc]() { tc(); });
+                _scheduled = _dispatchQueue->dispatchAsyncDelayed(
+                    std::chrono::duration_cast<std::chrono::milliseconds>(interval.get()), [tc]() { tc(); },
+                    DispatchQueue::Priority::Default, leeway);
             } else {
-                _dispatchQueue->createTimer(std::chrono::duration_cast<std::chrono::milliseconds>(interval.get()),
-                                            TimerCallback{_impl, ++_id});
+                _scheduled = _dispatchQueue->createTimer(
+                    std::chrono::duration_cast<std::chrono::milliseconds>(interval.get()), TimerCallback{_impl, ++_id},
+                    leeway);
             }
 
             _isRunning = true;
@@ -114,6 +123,7 @@ namespace bdn
     void Timer::stop()
     {
         running = false;
+        _scheduled.cancel();
         _id++;
         _isRunning = false;
     }
@@ -0,0 +1,75 @@
+#include <bdn/VirtualClock.h>
+
+#include <algorithm>
+
+namespace bdn
+{
+    void VirtualClock::advanceTo(TimePoint time)
+    {
+        std::lock_guard<std::recursive_mutex> advancing(_advanceMutex);
+
+        while (true) {
+            auto next = nextDue();
+            if (!next || *next > time) {
+                break;
+            }
+
+            // Deadlines before now() are overdue, the clock never runs
+            // backwards.
+            if (*next > now()) {
+                set(*next);
+            }
+
+            for (auto queue : queues()) {
+                queue->processDue();
+            }
+        }
+
+        if (time > now()) {
+            set(time);
+        }
+
+        // Gives idle functions their chance
+        for (auto queue : queues()) {
+            queue->processDue();
+        }
+    }
+
+    void VirtualClock::jumpBy(Clock::duration duration)
+    {
+        std::lock_guard<std::recursive_mutex> advancing(_advanceMutex);
+        set(now() + duration);
+    }
+
+    std::optional<VirtualClock::TimePoint> VirtualClock::nextDue()
+    {
+        std::optional<TimePoint> next;
+        for (auto queue : queues()) {
+            if (auto due = queue->nextDue()) {
+                next = next ? std::min(*next, *due) : *due;
+            }
+        }
+        return next;
+    }
+
+    void VirtualClock::attach(DispatchQueue *queue)
+    {
+        std::lock_guard<std::mutex> lk(_queuesMutex);
+        _queues.push_back(queue);
+    }
+
+    void VirtualClock::detach(DispatchQueue *queue)
+    {
+        std::lock_guard<std::mutex> lk(_queuesMutex);
+        _queues.erase(std::remove(_queues.begin(), _queues.end(), queue), _queues.end());
+    }
+
+    std::vector<DispatchQueue *> VirtualClock::queues()
+    {
+        // Copied because processing may create or destroy other queues
+        std::lock_guard<std::mutex> lk(_queuesMutex);
+        return _queues;
+    }
+
+    void VirtualClock::set(TimePoint time) { _now.store(time.time_since_epoch().count(), std::memory_order_release); }
+}
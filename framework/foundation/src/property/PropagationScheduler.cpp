@@ -0,0 +1,179 @@
+#include <bdn/property/PropagationScheduler.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace bdn
+{
+    namespace
+    {
+        struct KeyHash
+        {
+            size_t operator()(const PropagationScheduler::Key &key) const
+            {
+                return std::hash<const void *>()(key.target) * 31 + std::hash<const void *>()(key.edge);
+            }
+        };
+
+        struct Update
+        {
+            size_t depth;
+            uint64_t order;
+            PropagationScheduler::Key key;
+            // The update that was running when this one was scheduled
+            PropagationScheduler::Key cause;
+            Task function;
+        };
+
+        // Orders the heap so that the shallowest, earliest update comes first
+        bool runsLater(const Update &left, const Update &right)
+        {
+            if (left.depth != right.depth) {
+                return left.depth > right.depth;
+            }
+            return left.order > right.order;
+        }
+
+        struct SchedulerState
+        {
+            int schedulers = 0;
+            // Backing whose change the running propagation started from
+            const void *origin = nullptr;
+            // Backing a binding is updating right now, until it notifies
+            const void *bindingTarget = nullptr;
+            bool propagating = false;
+            uint64_t nextOrder = 0;
+
+            std::vector<Update> queue;
+            std::unordered_set<PropagationScheduler::Key, KeyHash> queued;
+            // Cause of the latest run of every update that ran in this
+            // propagation. Following the causes from any update always
+            // ends at the origin, at a key with a null target.
+            std::unordered_map<PropagationScheduler::Key, PropagationScheduler::Key, KeyHash> causes;
+            PropagationScheduler::Key running{nullptr, nullptr};
+
+            // True if the running update was caused by an update of target,
+            // i.e. a change of target would have come back to it
+            bool isCausedBy(const void *target) const
+            {
+                for (auto key = running; key.target != nullptr; key = causes.at(key)) {
+                    if (key.target == target) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            void reset()
+            {
+                queue.clear();
+                queued.clear();
+                causes.clear();
+                running = {nullptr, nullptr};
+                propagating = false;
+            }
+        };
+
+        thread_local SchedulerState t_scheduler;
+    }
+
+    PropagationScheduler::PropagationScheduler() { t_scheduler.schedulers++; }
+
+    PropagationScheduler::~PropagationScheduler() { t_scheduler.schedulers--; }
+
+    bool PropagationScheduler::isActive() { return t_scheduler.schedulers > 0; }
+
+    void PropagationScheduler::propagate(const void *origin, const std::function<void()> &notifyDependents)
+    {
+        auto &state = t_scheduler;
+        auto previousOrigin = state.origin;
+        state.origin = origin;
+
+        if (state.schedulers == 0 || state.propagating) {
+            try {
+                notifyDependents();
+            }
+            catch (...) {
+                state.origin = previousOrigin;
+                throw;
+            }
+            state.origin = previousOrigin;
+            return;
+        }
+
+        state.propagating = true;
+        try {
+            notifyDependents();
+
+            while (!state.queue.empty()) {
+                std::pop_heap(state.queue.begin(), state.queue.end(), runsLater);
+                auto update = std::move(state.queue.back());
+                state.queue.pop_back();
+
+                state.queued.erase(update.key);
+                state.causes[update.key] = update.cause;
+                state.running = update.key;
+                update.function();
+            }
+        }
+        catch (...) {
+            state.reset();
+            state.origin = previousOrigin;
+            throw;
+        }
+
+        state.reset();
+        state.origin = previousOrigin;
+    }
+
+    void PropagationScheduler::updateBindingTarget(const void *target, const std::function<void()> &update)
+    {
+        auto &state = t_scheduler;
+        auto previousTarget = state.bindingTarget;
+        state.bindingTarget = target;
+        try {
+            update();
+        }
+        catch (...) {
+            state.bindingTarget = previousTarget;
+            throw;
+        }
+        state.bindingTarget = previousTarget;
+    }
+
+    const void *PropagationScheduler::originOf(const void *changed)
+    {
+        auto &state = t_scheduler;
+        if (state.bindingTarget != changed || state.origin == nullptr) {
+            return changed;
+        }
+
+        state.bindingTarget = nullptr;
+        return state.origin;
+    }
+
+    bool PropagationScheduler::isOrigin(const void *backing) { return t_scheduler.origin == backing; }
+
+    bool PropagationScheduler::schedule(Key key, size_t depth, Task update)
+    {
+        auto &state = t_scheduler;
+        if (state.schedulers == 0 || !state.propagating) {
+            return false;
+        }
+
+        // An update that ran already runs again if one of its inputs
+        // changed after it, unless the change came from its own target.
+        if (state.isCausedBy(key.target) || !state.queued.insert(key).second) {
+            return true;
+        }
+
+        state.queue.push_back({depth, state.nextOrder++, key, state.running, std::move(update)});
+        std::push_heap(state.queue.begin(), state.queue.end(), runsLater);
+        return true;
+    }
+}
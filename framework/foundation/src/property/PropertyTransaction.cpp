@@ -0,0 +1,121 @@
+#include <bdn/property/PropertyTransaction.h>
+
+#include <bdn/log.h>
+
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace bdn
+{
+    namespace
+    {
+        struct TransactionState
+        {
+            struct Entry
+            {
+                PropertyTransaction::Key key;
+                Task notify;
+            };
+
+            // Binding depth of the notifying object and index into entries
+            using Order = std::pair<size_t, size_t>;
+
+            int depth = 0;
+
+            // In the order of the first change. Entries may be appended
+            // while committing.
+            std::vector<Entry> entries;
+            // Entries not delivered yet, lowest depth and earliest change first
+            std::priority_queue<Order, std::vector<Order>, std::greater<Order>> order;
+            // Index into entries for every notification not delivered yet
+            std::unordered_map<PropertyTransaction::Key, size_t> pending;
+
+            void clear()
+            {
+                entries.clear();
+                order = {};
+                pending.clear();
+            }
+        };
+
+        thread_local TransactionState t_transaction;
+    }
+
+    PropertyTransaction::PropertyTransaction() { t_transaction.depth++; }
+
+    PropertyTransaction::~PropertyTransaction()
+    {
+        logAndIgnoreException([this]() { commit(); }, "Subscriber threw while a PropertyTransaction committed");
+    }
+
+    void PropertyTransaction::commit()
+    {
+        if (_committed) {
+            return;
+        }
+        _committed = true;
+
+        auto &state = t_transaction;
+        if (state.depth > 1) {
+            state.depth--;
+            return;
+        }
+
+        // The transaction stays active while delivering, so that changes
+        // made by subscribers are queued behind the entries that caused
+        // them.
+        try {
+            while (!state.order.empty()) {
+                auto &entry = state.entries[state.order.top().second];
+                state.order.pop();
+
+                auto notify = std::move(entry.notify);
+                state.pending.erase(entry.key);
+                if (notify) {
+                    notify();
+                }
+            }
+        }
+        catch (...) {
+            state.clear();
+            state.depth = 0;
+            throw;
+        }
+
+        state.clear();
+        state.depth = 0;
+    }
+
+    bool PropertyTransaction::isActive() { return t_transaction.depth > 0; }
+
+    bool PropertyTransaction::defer(Key key, Task notify, size_t depth)
+    {
+        auto &state = t_transaction;
+        if (state.depth == 0) {
+            return false;
+        }
+
+        if (state.pending.emplace(key, state.entries.size()).second) {
+            state.order.emplace(depth, state.entries.size());
+            state.entries.push_back({key, std::move(notify)});
+        }
+        return true;
+    }
+
+    void PropertyTransaction::cancel(Key key)
+    {
+        auto &state = t_transaction;
+        if (state.depth == 0) {
+            return;
+        }
+
+        auto it = state.pending.find(key);
+        if (it != state.pending.end()) {
+            state.entries[it->second].notify = nullptr;
+            state.pending.erase(it);
+        }
+    }
+}
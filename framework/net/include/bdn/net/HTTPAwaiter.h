@@ -0,0 +1,80 @@
+#pragma once
+
+#include <bdn/net/HTTP.h>
+#include <bdn/net/HTTPRequest.h>
+#include <bdn/net/HTTPResponse.h>
+
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace bdn::net::http
+{
+    /** Awaitable returned by fetch(). */
+    class ResponseAwaiter
+    {
+      private:
+        struct State
+        {
+            std::mutex mutex;
+            bool abandoned = false;
+            std::shared_ptr<HTTPResponse> response;
+        };
+
+      public:
+        explicit ResponseAwaiter(HTTPRequest request)
+            : _request(std::move(request)), _state(std::make_shared<State>())
+        {}
+        ResponseAwaiter(const ResponseAwaiter &) = delete;
+        ResponseAwaiter &operator=(const ResponseAwaiter &) = delete;
+
+        // Only matters if the suspended frame is destroyed before the
+        // response arrives. The request can't be aborted, but the response
+        // is dropped instead of resuming a dead coroutine.
+        ~ResponseAwaiter()
+        {
+            std::unique_lock<std::mutex> lk(_state->mutex);
+            _state->abandoned = true;
+        }
+
+        bool await_ready() const noexcept { return false; }
+
+        template <class CoroutineHandle> void await_suspend(CoroutineHandle handle)
+        {
+            auto originalHandler = std::move(_request.doneHandler);
+            _request.doneHandler = [state = _state, handle,
+                                    originalHandler](const std::shared_ptr<HTTPResponse> &response) mutable {
+                if (originalHandler) {
+                    originalHandler(response);
+                }
+
+                {
+                    std::unique_lock<std::mutex> lk(state->mutex);
+                    if (state->abandoned) {
+                        return;
+                    }
+                    state->response = response;
+                }
+                handle.resume();
+            };
+
+            request(std::move(_request));
+        }
+
+        std::shared_ptr<HTTPResponse> await_resume()
+        {
+            std::unique_lock<std::mutex> lk(_state->mutex);
+            return std::move(_state->response);
+        }
+
+      private:
+        HTTPRequest _request;
+        std::shared_ptr<State> _state;
+    };
+
+    /** co_await fetch(request) sends request and resumes the coroutine with
+        the response. The coroutine continues on the thread the platform
+        delivers responses on, usually the main thread. Use
+        DispatchQueue::schedule() to hop elsewhere. See bdn/Coroutine.h. */
+    inline ResponseAwaiter fetch(HTTPRequest request) { return ResponseAwaiter(std::move(request)); }
+}
@@ -82,6 +82,7 @@ namespace bdn::ui
 
       private:
         void lazyInitCore() const;
+        void scheduleLayoutNow();
 
       protected:
         ValueWithFallback<std::shared_ptr<Layout>> _layout;
@@ -1,3 +1,4 @@
+#include <bdn/Application.h>
 #include <bdn/ui/UIApplicationController.h>
 #include <bdn/ui/View.h>
 #include <bdn/ui/ViewCoreFactory.h>
@@ -103,6 +104,23 @@ namespace bdn::ui
     }
 
     void View::scheduleLayout()
+    {
+        // A burst of property changes dirties the layout many times over,
+        // the core only needs to hear about it once per turn of the queue.
+        auto app = App();
+        auto self = weak_from_this();
+        if (app && app->dispatchQueue() && !self.expired()) {
+            app->dispatchQueue()->dispatchAsyncCoalesced(this, [self]() {
+                if (auto view = self.lock()) {
+                    view->scheduleLayoutNow();
+                }
+            });
+        } else {
+            scheduleLayoutNow();
+        }
+    }
+
+    void View::scheduleLayoutNow()
     {
         if (auto core = viewCore()) {
             core->scheduleLayout();
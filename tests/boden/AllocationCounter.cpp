@@ -0,0 +1,43 @@
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    std::atomic<size_t> g_allocations{0};
+    std::atomic<size_t> g_liveBytes{0};
+
+    // Keeps the size in front of each block, so that unsized deletes can
+    // account for it too.
+    constexpr size_t HeaderSize = alignof(std::max_align_t);
+}
+
+void *operator new(std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto p = static_cast<char *>(std::malloc(size + HeaderSize))) {
+        *reinterpret_cast<size_t *>(p) = size;
+        g_liveBytes.fetch_add(size, std::memory_order_relaxed);
+        return p + HeaderSize;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    if (p != nullptr) {
+        auto block = static_cast<char *>(p) - HeaderSize;
+        g_liveBytes.fetch_sub(*reinterpret_cast<size_t *>(block), std::memory_order_relaxed);
+        std::free(block);
+    }
+}
+
+void operator delete(void *p, std::size_t) noexcept { operator delete(p); }
+
+namespace bdn::test
+{
+    size_t allocationCount() { return g_allocations.load(); }
+    size_t liveAllocatedBytes() { return g_liveBytes.load(); }
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+
+namespace bdn::test
+{
+    /** Totals kept by the test executable's replacement of operator new. */
+    size_t allocationCount();
+    size_t liveAllocatedBytes();
+
+    template <class F> size_t countAllocations(F &&f)
+    {
+        size_t before = allocationCount();
+        f();
+        return allocationCount() - before;
+    }
+}
@@ -0,0 +1,254 @@
+#include <gtest/gtest.h>
+
+#include <bdn/ConcurrentNotifier.h>
+
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace bdn
+{
+    TEST(ConcurrentNotifier, Basic)
+    {
+        ConcurrentNotifier<int> notifier;
+        EXPECT_TRUE(notifier.empty());
+
+        std::vector<int> calls;
+        auto first = notifier.subscribe([&](int value) { calls.push_back(value); });
+        notifier += [&](int value) { calls.push_back(10 * value); };
+        EXPECT_FALSE(notifier.empty());
+
+        notifier.notify(1);
+        EXPECT_EQ(calls, (std::vector<int>{1, 10}));
+
+        notifier.unsubscribe(first);
+        notifier.unsubscribe(first);
+        notifier.notify(2);
+        EXPECT_EQ(calls, (std::vector<int>{1, 10, 20}));
+
+        notifier.unsubscribeAll();
+        EXPECT_TRUE(notifier.empty());
+        notifier.notify(3);
+        EXPECT_EQ(calls.size(), 3u);
+    }
+
+    TEST(ConcurrentNotifier, ChangeDuringNotify)
+    {
+        ConcurrentNotifier<> notifier;
+        int selfCalls = 0;
+        int addedCalls = 0;
+        ConcurrentNotifier<>::Subscription self;
+
+        self = notifier.subscribe([&]() {
+            selfCalls++;
+            // Neither deadlocks nor affects the running notification
+            notifier.unsubscribe(self);
+            notifier.subscribe([&]() { addedCalls++; });
+        });
+
+        notifier.notify();
+        EXPECT_EQ(selfCalls, 1);
+        EXPECT_EQ(addedCalls, 0);
+
+        notifier.notify();
+        EXPECT_EQ(selfCalls, 1);
+        EXPECT_EQ(addedCalls, 1);
+    }
+
+    TEST(ConcurrentNotifier, NotifyInParallel)
+    {
+        ConcurrentNotifier<> notifier;
+        std::atomic<int> inside{0};
+        std::atomic<bool> overlapped{false};
+
+        notifier.subscribe([&]() {
+            inside++;
+            auto until = std::chrono::steady_clock::now() + 5s;
+            while (inside < 2 && std::chrono::steady_clock::now() < until) {
+                std::this_thread::yield();
+            }
+            overlapped = inside == 2;
+        });
+
+        std::thread other([&]() { notifier.notify(); });
+        notifier.notify();
+        other.join();
+
+        EXPECT_TRUE(overlapped);
+    }
+
+    TEST(ConcurrentNotifier, UnsubscribeWaitsForRunningCall)
+    {
+        ConcurrentNotifier<> notifier;
+        std::promise<void> started;
+        std::promise<void> release;
+        auto released = release.get_future().share();
+        std::atomic<int> calls{0};
+
+        auto sub = notifier.subscribe([&]() {
+            if (calls++ == 0) {
+                started.set_value();
+                released.wait();
+            }
+        });
+
+        std::thread notifying([&]() { notifier.notify(); });
+        started.get_future().wait();
+
+        auto unsubscribed = std::async(std::launch::async, [&]() { notifier.unsubscribe(sub); });
+        EXPECT_EQ(unsubscribed.wait_for(50ms), std::future_status::timeout);
+
+        release.set_value();
+        unsubscribed.wait();
+        notifying.join();
+
+        notifier.notify();
+        EXPECT_EQ(calls, 1);
+    }
+
+    TEST(ConcurrentNotifier, Stress)
+    {
+        ConcurrentNotifier<int> notifier;
+        std::atomic<bool> stop{false};
+        std::atomic<int> afterUnsubscribe{0};
+
+        std::vector<std::thread> notifying;
+        for (int i = 0; i < 4; i++) {
+            notifying.emplace_back([&]() {
+                while (!stop) {
+                    notifier.notify(1);
+                }
+            });
+        }
+
+        for (int i = 0; i < 2000; i++) {
+            auto removed = std::make_shared<std::atomic<bool>>(false);
+            auto sub = notifier.subscribe([&afterUnsubscribe, removed](int) {
+                if (*removed) {
+                    afterUnsubscribe++;
+                }
+            });
+            notifier.unsubscribe(sub);
+            *removed = true;
+        }
+
+        stop = true;
+        for (auto &thread : notifying) {
+            thread.join();
+        }
+
+        EXPECT_EQ(afterUnsubscribe, 0);
+        EXPECT_TRUE(notifier.empty());
+    }
+
+    TEST(ConcurrentNotifier, ChangesWhileNotifiersSpinFreeSnapshots)
+    {
+        ConcurrentNotifier<> notifier;
+        for (int i = 0; i < 16; i++) {
+            notifier.subscribe([]() {});
+        }
+
+        // One notification holds its snapshot for the whole test
+        std::promise<void> started;
+        std::promise<void> release;
+        std::atomic<bool> holds{false};
+        auto blocked = notifier.subscribe([&, released = release.get_future().share()]() {
+            if (!holds.exchange(true)) {
+                started.set_value();
+                released.wait();
+            }
+        });
+        std::thread holding([&]() { notifier.notify(); });
+        started.get_future().wait();
+
+        std::atomic<bool> stop{false};
+        std::atomic<int> spins{0};
+        std::vector<std::thread> notifying;
+        for (int i = 0; i < 4; i++) {
+            notifying.emplace_back([&]() {
+                while (!stop) {
+                    notifier.notify();
+                    spins++;
+                }
+            });
+        }
+        while (spins < 100) {
+            std::this_thread::yield();
+        }
+
+        auto liveBefore = test::liveAllocatedBytes();
+        for (int i = 0; i < 5000; i++) {
+            notifier.unsubscribe(notifier.subscribe([]() {}));
+        }
+        auto liveAfter = test::liveAllocatedBytes();
+
+        stop = true;
+        for (auto &thread : notifying) {
+            thread.join();
+        }
+        release.set_value();
+        holding.join();
+        notifier.unsubscribe(blocked);
+
+        // Each change replaces a snapshot of about 400 bytes
+        EXPECT_LT(liveAfter, liveBefore + 64 * 1024);
+    }
+
+    TEST(ConcurrentNotifier, SubscribeOnQueueLatestOnly)
+    {
+        auto queue = std::make_shared<DispatchQueue>(false);
+        auto queueThread = queue->dispatchSync([]() { return std::this_thread::get_id(); });
+
+        ConcurrentNotifier<int> notifier;
+        std::vector<int> calls;
+        notifier.subscribe(
+            [&](int value) {
+                EXPECT_EQ(std::this_thread::get_id(), queueThread);
+                calls.push_back(value);
+            },
+            queue, CoalescePolicy::LatestOnly);
+
+        std::vector<std::thread> producers;
+        for (int p = 0; p < 4; p++) {
+            producers.emplace_back([&]() {
+                for (int i = 0; i < 1000; i++) {
+                    notifier.notify(i);
+                }
+            });
+        }
+        for (auto &thread : producers) {
+            thread.join();
+        }
+        notifier.notify(-1);
+
+        queue->dispatchSync([]() {});
+        ASSERT_FALSE(calls.empty());
+        EXPECT_LE(calls.size(), 4001u);
+        EXPECT_EQ(calls.back(), -1);
+    }
+
+    TEST(ConcurrentNotifier, UnsubscribeDropsQueuedDeliveries)
+    {
+        auto queue = std::make_shared<DispatchQueue>(false);
+
+        ConcurrentNotifier<> notifier;
+        std::atomic<int> calls{0};
+        auto sub = notifier.subscribe([&]() { calls++; }, queue);
+
+        std::promise<void> release;
+        queue->dispatchAsync([released = release.get_future().share()]() { released.wait(); });
+        notifier.notify();
+        notifier.unsubscribe(sub);
+        release.set_value();
+
+        queue->dispatchSync([]() {});
+        EXPECT_EQ(calls, 0);
+    }
+}
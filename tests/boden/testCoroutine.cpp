@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+
+#include <bdn/Coroutine.h>
+
+#include "AllocationCounter.h"
+
+#ifdef BDN_HAS_COROUTINES
+
+#include <future>
+#include <stdexcept>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+namespace bdn
+{
+    static co::Task<int> answer(DispatchQueue &queue)
+    {
+        co_await queue.schedule();
+        co_return 42;
+    }
+
+    static co::Task<int> failing(DispatchQueue &queue)
+    {
+        co_await queue.schedule();
+        throw std::invalid_argument("test");
+    }
+
+    TEST(Coroutine, Schedule)
+    {
+        DispatchQueue queue;
+        auto queueThread = queue.dispatchSync([]() { return std::this_thread::get_id(); });
+
+        std::promise<std::thread::id> resumedOn;
+        co::spawn([](DispatchQueue &queue, std::promise<std::thread::id> &resumedOn) -> co::Task<> {
+            co_await queue.schedule();
+            resumedOn.set_value(std::this_thread::get_id());
+        }(queue, resumedOn));
+
+        auto future = resumedOn.get_future();
+        ASSERT_EQ(future.wait_for(5s), std::future_status::ready);
+        EXPECT_EQ(future.get(), queueThread);
+    }
+
+    TEST(Coroutine, AwaitResult)
+    {
+        DispatchQueue queue;
+        std::promise<int> result;
+
+        co::spawn(
+            [](DispatchQueue &queue) -> co::Task<int> {
+                int value = co_await answer(queue);
+                try {
+                    co_await failing(queue);
+                }
+                catch (std::invalid_argument &) {
+                    value++;
+                }
+                co_return value;
+            }(queue),
+            [&](int value) { result.set_value(value); });
+
+        auto future = result.get_future();
+        ASSERT_EQ(future.wait_for(5s), std::future_status::ready);
+        EXPECT_EQ(future.get(), 43);
+    }
+
+    TEST(Coroutine, Delay)
+    {
+        DispatchQueue queue;
+        std::promise<DispatchQueue::Clock::duration> elapsed;
+
+        co::spawn([](DispatchQueue &queue, std::promise<DispatchQueue::Clock::duration> &elapsed) -> co::Task<> {
+            auto start = DispatchQueue::Clock::now();
+            co_await co::delay(queue, 50ms);
+            elapsed.set_value(DispatchQueue::Clock::now() - start);
+        }(queue, elapsed));
+
+        auto future = elapsed.get_future();
+        ASSERT_EQ(future.wait_for(5s), std::future_status::ready);
+        EXPECT_GE(future.get(), 50ms);
+    }
+
+    static co::Task<> delayRepeatedly(DispatchQueue &queue, int count, std::promise<void> &done)
+    {
+        for (int i = 0; i < count; i++) {
+            co_await co::delay(queue, 0ms);
+        }
+        done.set_value();
+    }
+
+    TEST(Coroutine, DelayDoesNotAllocate)
+    {
+        DispatchQueue queue;
+
+        auto allocationsFor = [&](int delays) {
+            std::promise<void> done;
+            auto finished = done.get_future();
+            return test::countAllocations([&]() {
+                co::spawn(delayRepeatedly(queue, delays, done));
+                finished.wait();
+            });
+        };
+
+        // Lets the timer wheel grow its storage
+        allocationsFor(10);
+
+        // Only the frame and the spawning machinery allocate, each
+        // co_await delay() allocates nothing on top
+        EXPECT_EQ(allocationsFor(110), allocationsFor(10));
+    }
+
+    TEST(Coroutine, DestroyCancelsDelay)
+    {
+        DispatchQueue queue;
+        bool resumed = false;
+
+        auto task = [](DispatchQueue &queue, bool &resumed) -> co::Task<> {
+            co_await co::delay(queue, 20ms);
+            resumed = true;
+        }(queue, resumed);
+
+        // Start and destroy the task on the queue, the thread that would
+        // resume it. The spawned starter stays suspended and is leaked.
+        std::optional<co::Task<>> holder;
+        queue.dispatchSync([&]() {
+            holder.emplace([](co::Task<> inner) -> co::Task<> { co_await std::move(inner); }(std::move(task)));
+            auto starter = [](co::Task<> &outer) -> co::Task<> { co_await outer; };
+            co::spawn(starter(*holder));
+        });
+        queue.dispatchSync([&]() { holder.reset(); });
+
+        std::this_thread::sleep_for(50ms);
+        queue.dispatchSync([]() {});
+        EXPECT_FALSE(resumed);
+    }
+}
+
+#endif
@@ -1,6 +1,10 @@
+#include "AllocationCounter.h"
+
+#include <algorithm>
 #include <array>
 #include <bdn/Application.h>
 #include <bdn/DispatchQueue.h>
+#include <bdn/VirtualClock.h>
 #include <bdn/log.h>
 #include <chrono>
 #include <future>
@@ -9,6 +13,7 @@
 #include <queue>
 #include <random>
 #include <thread>
+#include <vector>
 
 using namespace std::chrono_literals;
 
@@ -71,6 +76,38 @@ namespace bdn
         EXPECT_EQ(consumer.triggers, 1);
     }
 
+    TEST(DispatchQueue, SyncReturnValue)
+    {
+        DispatchQueue queue(false);
+
+        auto threadId = queue.dispatchSync([]() { return std::this_thread::get_id(); });
+        EXPECT_NE(threadId, std::this_thread::get_id());
+
+        auto value = queue.dispatchSync([]() { return std::make_unique<int>(42); });
+        ASSERT_TRUE(value);
+        EXPECT_EQ(*value, 42);
+    }
+
+    TEST(DispatchQueue, SyncException)
+    {
+        DispatchQueue queue(false);
+
+        EXPECT_THROW(queue.dispatchSync([]() { throw std::invalid_argument("test"); }), std::invalid_argument);
+        EXPECT_EQ(queue.dispatchSync([]() { return 1; }), 1);
+    }
+
+    TEST(DispatchQueue, SyncAfterCancel)
+    {
+        DispatchQueue queue(false);
+        queue.cancel();
+
+        bool called = false;
+        queue.dispatchSync([&]() { called = true; });
+        EXPECT_FALSE(called);
+
+        EXPECT_THROW(queue.dispatchSync([]() { return 1; }), std::runtime_error);
+    }
+
     TEST(DispatchQueue, SyncRecursive)
     {
         DispatchConsumer consumer;
@@ -97,6 +134,43 @@ namespace bdn
         EXPECT_TRUE(consumer.waitFor(2));
     }
 
+    TEST(DispatchQueue, AsyncCoalesced)
+    {
+        DispatchQueue queue(false);
+        std::promise<void> release;
+        auto released = release.get_future().share();
+        queue.dispatchAsync([released]() { released.wait(); });
+
+        int first = 0;
+        int second = 0;
+        std::vector<int> values;
+        EXPECT_TRUE(queue.dispatchAsyncCoalesced(&first, [&]() { values.push_back(1); }));
+        EXPECT_TRUE(queue.dispatchAsyncCoalesced(&second, [&]() { values.push_back(10); }));
+        for (int i = 2; i <= 100; i++) {
+            EXPECT_FALSE(queue.dispatchAsyncCoalesced(&first, [&, i]() { values.push_back(i); }));
+        }
+
+        release.set_value();
+        queue.dispatchSync([]() {});
+
+        // Only the latest function ran, in the place of the first one
+        EXPECT_EQ(values, (std::vector<int>{100, 10}));
+    }
+
+    TEST(DispatchQueue, AsyncCoalescedAgainAfterRun)
+    {
+        DispatchConsumer consumer;
+        DispatchQueue queue(false);
+        int key = 0;
+
+        queue.dispatchAsyncCoalesced(&key, [&]() {
+            EXPECT_TRUE(queue.dispatchAsyncCoalesced(&key, std::ref(consumer)));
+            consumer();
+        });
+
+        EXPECT_TRUE(consumer.waitFor(2));
+    }
+
     TEST(DispatchQueue, Delayed)
     {
         DispatchConsumer consumer;
@@ -126,6 +200,463 @@ namespace bdn
         EXPECT_GE(DispatchQueue::Clock::now(), t + 100ms);
     }
 
+    TEST(DispatchQueue, CancelDelayed)
+    {
+        auto clock = std::make_shared<VirtualClock>();
+        DispatchQueue queue(true, clock);
+
+        int calls = 0;
+        auto token = queue.dispatchAsyncDelayed(50ms, [&]() { calls += 10; });
+        queue.dispatchAsyncDelayed(100ms, [&]() { calls++; });
+
+        EXPECT_TRUE(token.cancel());
+        EXPECT_FALSE(token.cancel());
+
+        clock->advanceBy(1s);
+        EXPECT_EQ(calls, 1);
+    }
+
+    TEST(DispatchQueue, CancelTimer)
+    {
+        auto clock = std::make_shared<VirtualClock>();
+        DispatchQueue queue(true, clock);
+
+        int calls = 0;
+        auto token = queue.createTimer(5ms, [&]() {
+            calls++;
+            return true;
+        });
+
+        clock->advanceBy(15ms);
+        EXPECT_EQ(calls, 3);
+        EXPECT_TRUE(token.cancel());
+
+        clock->advanceBy(1s);
+        EXPECT_EQ(calls, 3);
+    }
+
+    TEST(DispatchQueue, TimerDoesNotDrift)
+    {
+        auto clock = std::make_shared<VirtualClock>();
+        DispatchQueue queue(true, clock);
+        auto start = clock->now();
+
+        std::vector<DispatchQueue::TimePoint> calls;
+        queue.createTimer(10ms, [&]() {
+            calls.push_back(clock->now());
+            // Would add up to 50ms of drift over ten ticks
+            clock->jumpBy(5ms);
+            return calls.size() != 10;
+        });
+
+        clock->advanceBy(1s);
+
+        ASSERT_EQ(calls.size(), 10u);
+        for (size_t i = 0; i < calls.size(); i++) {
+            EXPECT_EQ(calls[i], start + 10ms * static_cast<int>(i + 1));
+        }
+    }
+
+    struct TimerCall
+    {
+        uint64_t missedTicks;
+        DispatchQueue::Clock::duration at;
+    };
+
+    // Ticks every 10ms, the queue is blocked from 10ms to 65ms
+    static std::vector<TimerCall> ticksAfterStall(DispatchQueue::MissedTickPolicy policy)
+    {
+        auto clock = std::make_shared<VirtualClock>();
+        DispatchQueue queue(true, clock);
+        auto start = clock->now();
+
+        std::vector<TimerCall> calls;
+        queue.createTimer(
+            10ms,
+            [&](uint64_t missedTicks) {
+                calls.push_back({missedTicks, clock->now() - start});
+                return calls.size() < 8;
+            },
+            policy);
+
+        clock->advanceBy(10ms);
+        clock->jumpBy(55ms);
+        clock->advanceBy(1s);
+
+        return calls;
+    }
+
+    TEST(DispatchQueue, TimerMissedTicksCoalesce)
+    {
+        auto calls = ticksAfterStall(DispatchQueue::MissedTickPolicy::Coalesce);
+
+        ASSERT_EQ(calls.size(), 8u);
+        EXPECT_EQ(calls[1].missedTicks, 4u);
+        EXPECT_EQ(calls[1].at, 65ms);
+        // Back on the original schedule afterwards
+        EXPECT_EQ(calls[2].missedTicks, 0u);
+        EXPECT_EQ(calls[2].at, 70ms);
+    }
+
+    TEST(DispatchQueue, TimerMissedTicksCatchUp)
+    {
+        auto calls = ticksAfterStall(DispatchQueue::MissedTickPolicy::CatchUp);
+
+        ASSERT_EQ(calls.size(), 8u);
+        // The ticks due at 20ms to 60ms are delivered in a burst
+        for (size_t i = 1; i <= 5; i++) {
+            EXPECT_EQ(calls[i].missedTicks, 0u);
+            EXPECT_EQ(calls[i].at, 65ms);
+        }
+        EXPECT_EQ(calls[6].at, 70ms);
+    }
+
+    TEST(DispatchQueue, TimerMissedTicksSkip)
+    {
+        auto calls = ticksAfterStall(DispatchQueue::MissedTickPolicy::Skip);
+
+        ASSERT_EQ(calls.size(), 8u);
+        EXPECT_EQ(calls[1].missedTicks, 4u);
+        EXPECT_EQ(calls[1].at, 65ms);
+        // The schedule restarts a full interval after the late call
+        EXPECT_EQ(calls[2].at, 75ms);
+        EXPECT_EQ(calls[3].at, 85ms);
+    }
+
+    TEST(DispatchQueue, ProcessBudget)
+    {
+        auto clock = std::make_shared<VirtualClock>();
+        DispatchQueue queue(true, clock);
+        auto start = clock->now();
+
+        queue.setProcessBudget(2ms);
+        EXPECT_EQ(queue.processBudget(), 2ms);
+
+        // 40ms worth of functions that take 1ms each and queue the next one
+        int remaining = 40;
+        std::function<void()> work = [&]() {
+            clock->jumpBy(1ms);
+            if (--remaining > 0) {
+                queue.dispatchAsync(work);
+            }
+        };
+        for (int i = 0; i < 4; i++) {
+            queue.dispatchAsync(work);
+        }
+
+        DispatchQueue::TimePoint fired;
+        queue.createTimer(10ms, [&]() {
+            fired = clock->now();
+            return false;
+        });
+
+        clock->runDue();
+        EXPECT_LE(remaining, 0);
+
+        auto metrics = queue.processMetrics();
+        EXPECT_GT(metrics.budgetExhausted, 0u);
+        // A pass ends with the first function that exceeds the budget
+        EXPECT_LE(metrics.longestPass, 2ms + 1ms);
+        EXPECT_GE(fired - start, 10ms);
+        EXPECT_LE(fired - start, 10ms + 2ms + 1ms);
+
+        queue.resetProcessMetrics();
+        EXPECT_EQ(queue.processMetrics().passes, 0u);
+    }
+
+    TEST(DispatchQueue, WhenIdle)
+    {
+        DispatchConsumer consumer;
+        DispatchQueue queue(false);
+
+        DispatchQueue::Clock::duration remaining{};
+        bool didTimeout = true;
+        queue.dispatchWhenIdle([&](const DispatchQueue::IdleDeadline &deadline) {
+            remaining = deadline.timeRemaining();
+            didTimeout = deadline.didTimeout;
+            consumer();
+        });
+
+        ASSERT_TRUE(consumer.waitFor(1));
+        EXPECT_GT(remaining, DispatchQueue::Clock::duration::zero());
+        EXPECT_LE(remaining, DispatchQueue::MaxIdlePeriod);
+        EXPECT_FALSE(didTimeout);
+    }
+
+    // Keeps queue busy until the returned flag is cleared
+    static std::shared_ptr<std::atomic<bool>> flood(DispatchQueue &queue)
+    {
+        auto flooding = std::make_shared<std::atomic<bool>>(true);
+        auto repost = std::make_shared<std::function<void()>>();
+        *repost = [&queue, flooding, weakRepost = std::weak_ptr<std::function<void()>>(repost)]() {
+            if (*flooding) {
+                if (auto repost = weakRepost.lock()) {
+                    queue.dispatchAsync([repost]() { (*repost)(); });
+                }
+            }
+        };
+        queue.dispatchAsync([repost]() { (*repost)(); });
+        return flooding;
+    }
+
+    TEST(DispatchQueue, WhenIdleWaitsForBusyQueue)
+    {
+        DispatchConsumer consumer;
+        DispatchQueue queue(false);
+
+        auto flooding = flood(queue);
+
+        std::atomic<bool> ranWhileFlooding{false};
+        queue.dispatchWhenIdle([&](const DispatchQueue::IdleDeadline &) {
+            ranWhileFlooding = flooding->load();
+            consumer();
+        });
+
+        std::this_thread::sleep_for(30ms);
+        EXPECT_EQ(consumer.triggers, 0);
+        *flooding = false;
+
+        ASSERT_TRUE(consumer.waitFor(1));
+        EXPECT_FALSE(ranWhileFlooding);
+    }
+
+    TEST(DispatchQueue, WhenIdleDeadline)
+    {
+        DispatchConsumer consumer;
+        DispatchQueue queue(false);
+
+        auto flooding = flood(queue);
+
+        auto start = DispatchQueue::Clock::now();
+        DispatchQueue::TimePoint ranAt;
+        bool didTimeout = false;
+        queue.dispatchWhenIdle(
+            [&](const DispatchQueue::IdleDeadline &deadline) {
+                ranAt = DispatchQueue::Clock::now();
+                didTimeout = deadline.didTimeout;
+                consumer();
+            },
+            20ms);
+
+        ASSERT_TRUE(consumer.waitFor(1));
+        *flooding = false;
+
+        EXPECT_TRUE(didTimeout);
+        EXPECT_GE(ranAt - start, 20ms);
+    }
+
+    TEST(DispatchQueue, CancelWhenIdle)
+    {
+        DispatchQueue queue(false);
+        auto flooding = flood(queue);
+
+        bool called = false;
+        auto token = queue.dispatchWhenIdle([&](const DispatchQueue::IdleDeadline &) { called = true; });
+        EXPECT_TRUE(token.cancel());
+        *flooding = false;
+
+        std::this_thread::sleep_for(20ms);
+        queue.dispatchSync([]() {});
+        EXPECT_FALSE(called);
+    }
+
+    TEST(DispatchQueue, SyncRoundTrip)
+    {
+        DispatchQueue queue(false);
+
+        int counter = 0;
+        queue.dispatchSync([&counter]() { counter++; });
+
+        const size_t iterations = 20000;
+        std::vector<std::chrono::nanoseconds> samples;
+        samples.reserve(iterations);
+
+        // The result and the wakeup live on the caller's stack, only the
+        // lane's queue node is allocated.
+        auto allocations = test::countAllocations([&]() {
+            for (size_t i = 0; i < iterations; i++) {
+                auto start = DispatchQueue::Clock::now();
+                queue.dispatchSync([&counter]() { counter++; });
+                samples.push_back(DispatchQueue::Clock::now() - start);
+            }
+        });
+
+        EXPECT_EQ(counter, static_cast<int>(iterations) + 1);
+        EXPECT_LE(allocations, iterations);
+
+        std::sort(samples.begin(), samples.end());
+        logstream() << "dispatchSync round trip: p50 " << samples[iterations / 2].count() << "ns, p99 "
+                    << samples[iterations * 99 / 100].count() << "ns, max " << samples.back().count()
+                    << "ns, allocations per round trip " << static_cast<double>(allocations) / iterations;
+    }
+
+    TEST(DispatchQueue, PriorityOrder)
+    {
+        DispatchQueue queue(true);
+        std::vector<int> order;
+
+        queue.dispatchAsync([&]() { order.push_back(3); }, DispatchQueue::Priority::Background);
+        queue.dispatchAsync([&]() { order.push_back(2); });
+        queue.dispatchAsync([&]() { order.push_back(1); }, DispatchQueue::Priority::Interactive);
+        queue.dispatchAsync([&]() { order.push_back(4); }, DispatchQueue::Priority::Background);
+
+        for (int i = 0; i < 4; i++) {
+            queue.executeSync();
+        }
+
+        EXPECT_EQ(order, (std::vector<int>{1, 2, 3, 4}));
+    }
+
+    TEST(DispatchQueue, PriorityAging)
+    {
+        DispatchQueue queue(true);
+        std::vector<int> order;
+
+        queue.dispatchAsync([&]() { order.push_back(2); }, DispatchQueue::Priority::Background);
+        std::this_thread::sleep_for(DispatchQueue::BackgroundAging);
+        queue.dispatchAsync([&]() { order.push_back(1); }, DispatchQueue::Priority::Interactive);
+
+        queue.executeSync();
+        queue.executeSync();
+
+        EXPECT_EQ(order, (std::vector<int>{2, 1}));
+
+        auto metrics = queue.waitMetrics(DispatchQueue::Priority::Background);
+        EXPECT_EQ(metrics.count, 1u);
+        EXPECT_GE(metrics.max, DispatchQueue::BackgroundAging);
+        EXPECT_EQ(queue.waitMetrics(DispatchQueue::Priority::Interactive).count, 1u);
+        EXPECT_EQ(queue.waitMetrics(DispatchQueue::Priority::Default).count, 0u);
+
+        queue.resetWaitMetrics();
+        EXPECT_EQ(queue.waitMetrics(DispatchQueue::Priority::Background).count, 0u);
+    }
+
+    TEST(DispatchQueue, DelayedPriority)
+    {
+        DispatchQueue queue(false);
+        std::promise<void> release;
+        std::vector<int> order;
+
+        queue.dispatchAsync([future = release.get_future().share()]() { future.wait(); });
+        queue.dispatchAsyncDelayed(1ms, [&]() { order.push_back(2); }, DispatchQueue::Priority::Background);
+        std::this_thread::sleep_for(10ms);
+        queue.dispatchAsync([&]() { order.push_back(1); }, DispatchQueue::Priority::Interactive);
+
+        release.set_value();
+        queue.dispatchSync([]() {}, DispatchQueue::Priority::Background);
+
+        EXPECT_EQ(order, (std::vector<int>{1, 2}));
+    }
+
+    TEST(DispatchQueue, InteractiveWaitUnderBackgroundLoad)
+    {
+        DispatchQueue queue(false);
+
+        const int backgroundCount = 20000;
+        const int interactiveCount = 200;
+        std::atomic<int> sink{0};
+
+        for (int i = 0; i < backgroundCount; i++) {
+            queue.dispatchAsync(
+                [&sink]() {
+                    for (int j = 0; j < 200; j++) {
+                        sink += j;
+                    }
+                },
+                DispatchQueue::Priority::Background);
+
+            if (i % (backgroundCount / interactiveCount) == 0) {
+                queue.dispatchAsync([]() {}, DispatchQueue::Priority::Interactive);
+            }
+        }
+        queue.dispatchSync([]() {}, DispatchQueue::Priority::Background);
+
+        auto interactive = queue.waitMetrics(DispatchQueue::Priority::Interactive);
+        auto background = queue.waitMetrics(DispatchQueue::Priority::Background);
+
+        EXPECT_EQ(interactive.count, static_cast<uint64_t>(interactiveCount));
+        EXPECT_LT(interactive.mean(), background.mean());
+
+        logstream() << "Wait under background load: interactive mean "
+                    << std::chrono::duration_cast<std::chrono::microseconds>(interactive.mean()).count()
+                    << "us, max " << std::chrono::duration_cast<std::chrono::microseconds>(interactive.max).count()
+                    << "us; background mean "
+                    << std::chrono::duration_cast<std::chrono::microseconds>(background.mean()).count()
+                    << "us, max " << std::chrono::duration_cast<std::chrono::microseconds>(background.max).count()
+                    << "us";
+    }
+
+    TEST(DispatchQueue, LatencyHistogram)
+    {
+        LatencyHistogram histogram;
+        EXPECT_EQ(histogram.percentile(50), LatencyHistogram::Duration{});
+
+        for (int i = 0; i < 90; i++) {
+            histogram.record(500ns);
+        }
+        for (int i = 0; i < 10; i++) {
+            histogram.record(3ms);
+        }
+
+        EXPECT_EQ(histogram.count(), 100u);
+        EXPECT_EQ(histogram.max(), 3ms);
+        EXPECT_EQ(histogram.buckets()[0], 90u);
+        EXPECT_LE(histogram.percentile(50), 1us);
+        EXPECT_GT(histogram.percentile(99), 1ms);
+        EXPECT_LE(histogram.percentile(99), 3ms);
+    }
+
+#ifdef BDN_DISPATCH_INSTRUMENTATION
+    TEST(DispatchQueue, Statistics)
+    {
+        DispatchQueue queue;
+        std::promise<void> release;
+        auto released = release.get_future().share();
+
+        queue.dispatchAsync([released]() { released.wait(); });
+        for (int i = 0; i < 10; i++) {
+            queue.dispatchAsync([]() {});
+        }
+        auto token = queue.dispatchAsyncDelayed(1h, []() {});
+
+        release.set_value();
+        queue.dispatchSync([]() {});
+
+        auto statistics = queue.statistics();
+        EXPECT_EQ(statistics.runTime.count(), 12u);
+        EXPECT_EQ(statistics.waitTime.count(), 12u);
+        EXPECT_GE(statistics.maxDepth, 10u);
+        EXPECT_EQ(statistics.timedDepth, 1u);
+        EXPECT_EQ(statistics.maxTimedDepth, 1u);
+        EXPECT_GE(statistics.wakeups, 1u);
+
+        token.cancel();
+        queue.resetStatistics();
+        statistics = queue.statistics();
+        EXPECT_EQ(statistics.runTime.count(), 0u);
+        EXPECT_EQ(statistics.maxTimedDepth, 0u);
+    }
+
+    TEST(DispatchQueue, SlowTaskHandler)
+    {
+        DispatchQueue queue;
+        std::vector<DispatchQueue::SlowTask> slowTasks;
+        queue.setSlowTaskHandler(10ms, [&](const DispatchQueue::SlowTask &task) { slowTasks.push_back(task); });
+
+        queue.dispatchAsync([]() {});
+        int line = __LINE__ + 1;
+        queue.dispatchAsync([]() { std::this_thread::sleep_for(20ms); }, DispatchQueue::Priority::Background);
+        queue.dispatchSync([]() {}, DispatchQueue::Priority::Background);
+
+        ASSERT_EQ(slowTasks.size(), 1u);
+        EXPECT_EQ(slowTasks[0].priority, DispatchQueue::Priority::Background);
+        EXPECT_GE(slowTasks[0].runTime, 20ms);
+        EXPECT_EQ(slowTasks[0].source.line, line);
+        EXPECT_NE(std::string(slowTasks[0].source.file).find("testDispatchQueue.cpp"), std::string::npos);
+        EXPECT_EQ(queue.statistics().slowTasks, 1u);
+    }
+#endif
+
     TEST(DispatchQueue, Slave)
     {
         DispatchQueue queue(true);
@@ -0,0 +1,183 @@
+#if defined(__linux__)
+
+#include <gtest/gtest.h>
+
+#include <bdn/EpollDispatchQueue.h>
+#include <bdn/GenericApplication.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std::chrono_literals;
+
+namespace bdn
+{
+    struct Pipe
+    {
+        Pipe() { EXPECT_EQ(pipe2(fds, O_NONBLOCK | O_CLOEXEC), 0); }
+        ~Pipe()
+        {
+            close(fds[0]);
+            close(fds[1]);
+        }
+
+        void write(const std::string &text)
+        {
+            EXPECT_EQ(::write(fds[1], text.data(), text.size()), static_cast<ssize_t>(text.size()));
+        }
+
+        std::string readAll()
+        {
+            std::string result;
+            char buffer[64];
+            ssize_t count = 0;
+            while ((count = ::read(fds[0], buffer, sizeof(buffer))) > 0) {
+                result.append(buffer, static_cast<size_t>(count));
+            }
+            return result;
+        }
+
+        int readEnd() const { return fds[0]; }
+        int writeEnd() const { return fds[1]; }
+
+        int fds[2] = {-1, -1};
+    };
+
+    TEST(EpollDispatchQueue, AsyncAndSync)
+    {
+        EpollDispatchQueue queue;
+        std::promise<int> promise;
+        queue.dispatchAsync([&]() { promise.set_value(42); });
+        EXPECT_EQ(promise.get_future().get(), 42);
+        EXPECT_EQ(queue.dispatchSync([]() { return 7; }), 7);
+    }
+
+    TEST(EpollDispatchQueue, Delayed)
+    {
+        EpollDispatchQueue queue;
+        auto start = DispatchQueue::Clock::now();
+
+        std::promise<DispatchQueue::TimePoint> promise;
+        queue.dispatchAsyncDelayed(30ms, [&]() { promise.set_value(DispatchQueue::Clock::now()); });
+
+        auto called = promise.get_future().get();
+        EXPECT_GE(called, start + 30ms);
+        EXPECT_LT(called, start + 1s);
+    }
+
+    TEST(EpollDispatchQueue, Timer)
+    {
+        EpollDispatchQueue queue;
+        std::atomic<int> ticks{0};
+        std::promise<void> done;
+
+        queue.createTimer(5ms, [&]() {
+            if (++ticks == 10) {
+                done.set_value();
+                return false;
+            }
+            return true;
+        });
+
+        EXPECT_EQ(done.get_future().wait_for(10s), std::future_status::ready);
+    }
+
+    TEST(EpollDispatchQueue, Readable)
+    {
+        EpollDispatchQueue queue;
+        Pipe pipe;
+        auto queueThread = queue.dispatchSync([]() { return std::this_thread::get_id(); });
+
+        std::promise<std::string> received;
+        queue.watchFd(pipe.readEnd(), EpollDispatchQueue::Readable, [&](int fd, uint32_t events) {
+            EXPECT_EQ(fd, pipe.readEnd());
+            EXPECT_NE(events & EpollDispatchQueue::Readable, 0u);
+            EXPECT_EQ(std::this_thread::get_id(), queueThread);
+            received.set_value(pipe.readAll());
+            queue.unwatchFd(fd);
+        });
+
+        pipe.write("hello");
+        EXPECT_EQ(received.get_future().get(), "hello");
+        EXPECT_FALSE(queue.unwatchFd(pipe.readEnd()));
+    }
+
+    TEST(EpollDispatchQueue, EdgeTriggered)
+    {
+        EpollDispatchQueue queue;
+        Pipe pipe;
+        std::atomic<int> calls{0};
+
+        // Data that is left unread is not reported again
+        queue.watchFd(pipe.readEnd(), EpollDispatchQueue::Readable | EpollDispatchQueue::EdgeTriggered,
+                      [&](int, uint32_t) { calls++; });
+
+        pipe.write("a");
+        std::this_thread::sleep_for(50ms);
+        queue.dispatchSync([]() {});
+        EXPECT_EQ(calls, 1);
+
+        pipe.write("b");
+        std::this_thread::sleep_for(50ms);
+        queue.dispatchSync([]() {});
+        EXPECT_EQ(calls, 2);
+
+        queue.unwatchFd(pipe.readEnd());
+    }
+
+    TEST(EpollDispatchQueue, HangUp)
+    {
+        EpollDispatchQueue queue;
+        Pipe pipe;
+        std::promise<uint32_t> events;
+
+        queue.watchFd(pipe.readEnd(), EpollDispatchQueue::Readable, [&](int fd, uint32_t occurred) {
+            queue.unwatchFd(fd);
+            events.set_value(occurred);
+        });
+
+        close(pipe.fds[1]);
+        pipe.fds[1] = -1;
+        EXPECT_NE(events.get_future().get() & EpollDispatchQueue::HangUp, 0u);
+    }
+
+    TEST(EpollDispatchQueue, Slave)
+    {
+        EpollDispatchQueue queue(true);
+        Pipe pipe;
+        bool called = false;
+
+        queue.watchFd(pipe.readEnd(), EpollDispatchQueue::Readable, [&](int fd, uint32_t) {
+            called = true;
+            queue.unwatchFd(fd);
+            queue.cancel();
+        });
+
+        std::thread writer([&]() {
+            std::this_thread::sleep_for(20ms);
+            pipe.write("x");
+        });
+
+        queue.enter();
+        writer.join();
+        EXPECT_TRUE(called);
+    }
+
+    TEST(EpollDispatchQueue, GenericApplicationOptIn)
+    {
+        auto plain = std::make_shared<GenericApplication>([]() { return nullptr; }, 0, nullptr, true);
+        EXPECT_EQ(std::dynamic_pointer_cast<EpollDispatchQueue>(plain->dispatchQueue()), nullptr);
+
+        auto queue = std::make_shared<EpollDispatchQueue>(true);
+        auto app = std::make_shared<GenericApplication>([]() { return nullptr; }, 0, nullptr, true, queue);
+        EXPECT_EQ(app->dispatchQueue(), queue);
+    }
+}
+
+#endif
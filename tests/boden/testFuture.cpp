@@ -0,0 +1,243 @@
+#include <gtest/gtest.h>
+
+#include "AllocationCounter.h"
+
+#include <bdn/DispatchQueue.h>
+#include <bdn/Future.h>
+#include <bdn/ThreadPool.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+namespace bdn
+{
+    TEST(Future, Async)
+    {
+        auto queue = std::make_shared<DispatchQueue>();
+        auto future = async(queue, []() { return 42; });
+        EXPECT_EQ(future.get(), 42);
+        EXPECT_FALSE(future.valid());
+    }
+
+    TEST(Future, ThenAcrossQueues)
+    {
+        auto main = std::make_shared<DispatchQueue>();
+        auto pool = std::make_shared<ThreadPool>(2);
+        auto mainThread = main->dispatchSync([]() { return std::this_thread::get_id(); });
+
+        auto future = async(main, []() { return std::string("21"); })
+                          .then(pool,
+                                [pool](std::string text) {
+                                    EXPECT_TRUE(pool->isWorkerThread());
+                                    return std::stoi(text);
+                                })
+                          .then(main, [mainThread](int value) {
+                              EXPECT_EQ(std::this_thread::get_id(), mainThread);
+                              return value * 2;
+                          });
+
+        EXPECT_EQ(future.get(), 42);
+    }
+
+    TEST(Future, ThenBeforeCompletion)
+    {
+        Promise<int> promise;
+        std::atomic<int> calls{0};
+
+        auto future = promise.future()
+                          .then([&](int value) {
+                              calls++;
+                              return value + 1;
+                          })
+                          .then([&](int value) {
+                              calls++;
+                              return value + 1;
+                          })
+                          .then([&](int value) {
+                              calls++;
+                              return value + 1;
+                          })
+                          .then([&](int value) {
+                              calls++;
+                              return value + 1;
+                          });
+
+        EXPECT_FALSE(future.isReady());
+        promise.setValue(1);
+        EXPECT_TRUE(future.isReady());
+        EXPECT_EQ(future.get(), 5);
+        EXPECT_EQ(calls, 4);
+    }
+
+    TEST(Future, ChainAllocatesOnce)
+    {
+        int result = 0;
+        int offset = 1;
+
+        // Small captures and values stay inline, the chain state is the
+        // only allocation
+        auto allocations = test::countAllocations([&]() {
+            Promise<int> promise;
+            auto future = promise.future()
+                              .then([offset](int value) { return value + offset; })
+                              .then([offset](int value) { return value * 10 + offset; })
+                              .then([offset](int value) { return value - offset; });
+            promise.setValue(1);
+            result = future.get();
+        });
+
+        EXPECT_EQ(result, 20);
+        EXPECT_EQ(allocations, 1u);
+    }
+
+    TEST(Future, ThenFlattens)
+    {
+        auto queue = std::make_shared<DispatchQueue>();
+        auto future = async(queue, []() { return 20; }).then([queue](int value) {
+            return async(queue, [value]() { return value + 22; });
+        });
+        EXPECT_EQ(future.get(), 42);
+    }
+
+    TEST(Future, Void)
+    {
+        auto queue = std::make_shared<DispatchQueue>();
+        bool ran = false;
+        auto future = async(queue, [&]() { ran = true; }).then([&]() { return ran; });
+        EXPECT_TRUE(future.get());
+    }
+
+    TEST(Future, ExceptionSkipsContinuations)
+    {
+        auto queue = std::make_shared<DispatchQueue>();
+        bool called = false;
+
+        auto future = async(queue, []() -> int { throw std::invalid_argument("test"); }).then(queue, [&](int) {
+            called = true;
+            return 0;
+        });
+
+        EXPECT_THROW(future.get(), std::invalid_argument);
+        EXPECT_FALSE(called);
+    }
+
+    TEST(Future, Cancel)
+    {
+        auto queue = std::make_shared<DispatchQueue>();
+        bool called = false;
+
+        Promise<int> promise;
+        auto future = promise.future().then(queue, [&](int value) {
+            called = true;
+            return value;
+        });
+        future.cancel();
+        EXPECT_TRUE(promise.isCancelled());
+
+        promise.setValue(1);
+        EXPECT_THROW(future.get(), FutureCancelled);
+        EXPECT_FALSE(called);
+    }
+
+    TEST(Future, CancelSkipsQueuedFunction)
+    {
+        auto queue = std::make_shared<DispatchQueue>();
+        std::atomic<bool> release{false};
+        queue->dispatchAsync([&]() {
+            while (!release) {
+                std::this_thread::yield();
+            }
+        });
+
+        bool called = false;
+        auto future = async(queue, [&]() { called = true; });
+        future.cancel();
+        release = true;
+
+        EXPECT_THROW(future.get(), FutureCancelled);
+        EXPECT_FALSE(called);
+    }
+
+    TEST(Future, AbandonedPromise)
+    {
+        Future<int> future;
+        {
+            Promise<int> promise;
+            future = promise.future();
+        }
+        EXPECT_THROW(future.get(), FutureCancelled);
+    }
+
+    TEST(Future, WhenAll)
+    {
+        auto pool = std::make_shared<ThreadPool>(2);
+        std::vector<Future<int>> futures;
+        for (int i = 0; i < 10; i++) {
+            futures.push_back(async(pool, [i]() { return i * i; }));
+        }
+
+        auto values = whenAll(std::move(futures)).get();
+        ASSERT_EQ(values.size(), 10u);
+        for (int i = 0; i < 10; i++) {
+            EXPECT_EQ(values[i], i * i);
+        }
+
+        EXPECT_TRUE(whenAll(std::vector<Future<int>>()).get().empty());
+    }
+
+    TEST(Future, WhenAllFailureCancelsOthers)
+    {
+        Promise<int> failing;
+        Promise<int> pending;
+
+        std::vector<Future<int>> futures;
+        futures.push_back(failing.future());
+        futures.push_back(pending.future());
+        auto all = whenAll(std::move(futures));
+
+        failing.setException(std::make_exception_ptr(std::invalid_argument("test")));
+        EXPECT_TRUE(pending.isCancelled());
+        EXPECT_THROW(all.get(), std::invalid_argument);
+    }
+
+    TEST(Future, WhenAny)
+    {
+        Promise<int> slow;
+        Promise<int> fast;
+
+        std::vector<Future<int>> futures;
+        futures.push_back(slow.future());
+        futures.push_back(fast.future());
+        auto any = whenAny(std::move(futures));
+
+        fast.setValue(7);
+        EXPECT_TRUE(slow.isCancelled());
+
+        auto [index, value] = any.get();
+        EXPECT_EQ(index, 1u);
+        EXPECT_EQ(value, 7);
+    }
+
+    TEST(Future, CancelPropagatesToInputs)
+    {
+        Promise<int> a;
+        Promise<int> b;
+
+        std::vector<Future<int>> futures;
+        futures.push_back(a.future());
+        futures.push_back(b.future());
+        auto all = whenAll(std::move(futures)).then([](std::vector<int> values) { return values.size(); });
+
+        all.cancel();
+        EXPECT_TRUE(a.isCancelled());
+        EXPECT_TRUE(b.isCancelled());
+
+        a.setValue(1);
+        b.setValue(2);
+        EXPECT_THROW(all.get(), FutureCancelled);
+    }
+}
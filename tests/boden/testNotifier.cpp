@@ -1,7 +1,15 @@
 #include <gtest/gtest.h>
 
 #include <bdn/Notifier.h>
+#include <bdn/log.h>
+
+#include <array>
+#include <chrono>
+#include <future>
+#include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 using namespace std::string_literals;
 
@@ -143,4 +151,276 @@ namespace bdn
         EXPECT_EQ(cc1.callCount, 2);
         EXPECT_EQ(cc2.callCount, 1);
     }
+
+    TEST(Notifier, SubscribeDuringNotify)
+    {
+        Notifier<> notifier;
+        int calls = 0;
+
+        notifier.subscribe([&]() {
+            if (calls++ == 0) {
+                notifier.subscribe([&]() { calls++; });
+            }
+        });
+
+        // The new subscriber is called in the same run
+        notifier.notify();
+        EXPECT_EQ(calls, 2);
+    }
+
+    TEST(Notifier, OrderAfterReuse)
+    {
+        Notifier<> notifier;
+        std::vector<int> order;
+        std::vector<Notifier<>::Subscription> subs;
+
+        for (int i = 0; i < 20; i++) {
+            subs.push_back(notifier.subscribe([&order, i]() { order.push_back(i); }));
+        }
+        for (int i = 0; i < 20; i += 2) {
+            notifier.unsubscribe(subs[i]);
+        }
+        // Reuses the freed slots, but is still called last
+        for (int i = 20; i < 25; i++) {
+            notifier.subscribe([&order, i]() { order.push_back(i); });
+        }
+
+        notifier.notify();
+        EXPECT_EQ(order, (std::vector<int>{1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 20, 21, 22, 23, 24}));
+
+        // Unsubscribing twice or a handle of a reused slot does nothing
+        notifier.unsubscribe(subs[0]);
+        notifier.unsubscribe(subs[0]);
+        order.clear();
+        notifier.notify();
+        EXPECT_EQ(order.size(), 15u);
+    }
+
+    TEST(Notifier, NestedNotify)
+    {
+        Notifier<int> notifier;
+        std::vector<int> calls;
+        Notifier<int>::Subscription second;
+
+        notifier.subscribe([&](int depth) {
+            calls.push_back(depth);
+            if (depth == 0) {
+                notifier.notify(1);
+                notifier.unsubscribe(second);
+            }
+        });
+        second = notifier.subscribe([&](int depth) { calls.push_back(10 + depth); });
+
+        notifier.notify(0);
+        EXPECT_EQ(calls, (std::vector<int>{0, 1, 11}));
+
+        calls.clear();
+        notifier.notify(0);
+        EXPECT_EQ(calls, (std::vector<int>{0, 1}));
+    }
+
+    TEST(Notifier, Move)
+    {
+        Notifier<> notifier;
+        int calls = 0;
+        auto sub = notifier.subscribe([&]() { calls++; });
+
+        Notifier<> moved(std::move(notifier));
+        notifier.notify();
+        moved.notify();
+        EXPECT_EQ(calls, 1);
+        EXPECT_TRUE(notifier.empty());
+
+        moved.unsubscribe(sub);
+        moved.notify();
+        EXPECT_EQ(calls, 1);
+    }
+
+    // Blocks queue until the returned promise is fulfilled
+    static std::promise<void> blockQueue(DispatchQueue &queue)
+    {
+        std::promise<void> release;
+        queue.dispatchAsync([released = release.get_future().share()]() { released.wait(); });
+        return release;
+    }
+
+    TEST(Notifier, SubscribeOnQueue)
+    {
+        auto queue = std::make_shared<DispatchQueue>(false);
+        auto queueThread = queue->dispatchSync([]() { return std::this_thread::get_id(); });
+
+        Notifier<int> notifier;
+        std::vector<int> calls;
+        notifier.subscribe(
+            [&](int value) {
+                EXPECT_EQ(std::this_thread::get_id(), queueThread);
+                calls.push_back(value);
+            },
+            queue);
+
+        auto release = blockQueue(*queue);
+        for (int i = 0; i < 5; i++) {
+            notifier.notify(i);
+        }
+        release.set_value();
+
+        queue->dispatchSync([]() {});
+        EXPECT_EQ(calls, (std::vector<int>{0, 1, 2, 3, 4}));
+    }
+
+    TEST(Notifier, SubscribeOnQueueLatestOnly)
+    {
+        auto queue = std::make_shared<DispatchQueue>(false);
+
+        Notifier<std::string> notifier;
+        std::vector<std::string> calls;
+        std::vector<std::string> allCalls;
+        notifier.subscribe([&](const std::string &value) { calls.push_back(value); }, queue,
+                           CoalescePolicy::LatestOnly);
+        notifier.subscribe([&](const std::string &value) { allCalls.push_back(value); }, queue);
+
+        auto release = blockQueue(*queue);
+        for (int i = 0; i < 100; i++) {
+            notifier.notify(std::to_string(i));
+        }
+        release.set_value();
+        queue->dispatchSync([]() {});
+
+        EXPECT_EQ(calls, (std::vector<std::string>{"99"}));
+        EXPECT_EQ(allCalls.size(), 100u);
+
+        // Delivered notifications no longer coalesce with new ones
+        notifier.notify("next"s);
+        queue->dispatchSync([]() {});
+        EXPECT_EQ(calls, (std::vector<std::string>{"99", "next"}));
+    }
+
+    TEST(Notifier, UnsubscribeDropsQueuedDeliveries)
+    {
+        auto queue = std::make_shared<DispatchQueue>(false);
+
+        Notifier<> notifier;
+        int calls = 0;
+        auto sub = notifier.subscribe([&]() { calls++; }, queue);
+
+        auto release = blockQueue(*queue);
+        notifier.notify();
+        notifier.notify();
+        notifier.unsubscribe(sub);
+        release.set_value();
+
+        queue->dispatchSync([]() {});
+        EXPECT_EQ(calls, 0);
+    }
+
+    TEST(Notifier, UnsubscribeWaitsForRunningDelivery)
+    {
+        auto queue = std::make_shared<DispatchQueue>(false);
+
+        Notifier<> notifier;
+        std::promise<void> started;
+        std::promise<void> release;
+        std::atomic<bool> finished{false};
+        auto sub = notifier.subscribe(
+            [&, released = release.get_future().share()]() {
+                started.set_value();
+                released.wait();
+                finished = true;
+            },
+            queue);
+
+        notifier.notify();
+        started.get_future().wait();
+
+        auto unsubscribed = std::async(std::launch::async, [&]() { notifier.unsubscribe(sub); });
+        EXPECT_EQ(unsubscribed.wait_for(std::chrono::milliseconds(50)), std::future_status::timeout);
+
+        release.set_value();
+        unsubscribed.wait();
+        EXPECT_TRUE(finished);
+    }
+
+    TEST(Notifier, UnsubscribeFromQueuedDelivery)
+    {
+        auto queue = std::make_shared<DispatchQueue>(false);
+
+        Notifier<> notifier;
+        int calls = 0;
+        Notifier<>::Subscription sub;
+        sub = notifier.subscribe(
+            [&]() {
+                calls++;
+                notifier.unsubscribe(sub);
+            },
+            queue);
+
+        auto release = blockQueue(*queue);
+        notifier.notify();
+        notifier.notify();
+        release.set_value();
+
+        queue->dispatchSync([]() {});
+        EXPECT_EQ(calls, 1);
+    }
+
+    template <class F> static double nanosecondsPer(size_t count, F &&f)
+    {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / static_cast<double>(count);
+    }
+
+    TEST(Notifier, Benchmark)
+    {
+        const size_t count = 200000;
+        int sum = 0;
+
+        double subscribe = nanosecondsPer(count, [&]() {
+            Notifier<int> notifier;
+            for (size_t i = 0; i < count; i++) {
+                notifier.unsubscribe(notifier.subscribe([&sum](int value) { sum += value; }));
+            }
+        });
+
+        Notifier<int> one;
+        one += [&sum](int value) { sum += value; };
+        double notifyOne = nanosecondsPer(count, [&]() {
+            for (size_t i = 0; i < count; i++) {
+                one.notify(1);
+            }
+        });
+
+        Notifier<int> ten;
+        for (int i = 0; i < 10; i++) {
+            ten += [&sum](int value) { sum += value; };
+        }
+        double notifyTen = nanosecondsPer(count, [&]() {
+            for (size_t i = 0; i < count; i++) {
+                ten.notify(1);
+            }
+        });
+
+        // Every subscriber removes itself on its first call
+        Notifier<int> once;
+        std::array<Notifier<int>::Subscription, 4> subs;
+        double unsubscribeDuringNotify = nanosecondsPer(count, [&]() {
+            for (size_t i = 0; i < count / subs.size(); i++) {
+                for (auto &sub : subs) {
+                    sub = once.subscribe([&once, &sum, &sub](int value) {
+                        sum += value;
+                        once.unsubscribe(sub);
+                    });
+                }
+                once.notify(1);
+            }
+        });
+        EXPECT_TRUE(once.empty());
+
+        EXPECT_GT(sum, 0);
+
+        logstream() << "Notifier ns/op: subscribe+unsubscribe " << subscribe << ", notify 1 subscriber " << notifyOne
+                    << ", notify 10 subscribers " << notifyTen << ", unsubscribe during notify "
+                    << unsubscribeDuringNotify;
+    }
 }
@@ -1,7 +1,12 @@
 #include <gtest/gtest.h>
 
+#include "AllocationCounter.h"
+
 #include <bdn/property/Property.h>
 
+#include <future>
+#include <vector>
+
 using namespace std::string_literals;
 
 namespace bdn
@@ -64,9 +69,22 @@ namespace bdn
         EXPECT_EQ(cc.changeCount, 2);
 
         Property<std::function<void()>> p2;
+        ChangeCounter<std::function<void()>> cc2;
+        p2.onChange() += std::ref(cc2);
+
+        // Never equal, but the change stops once it comes back to p2
+        EXPECT_NO_THROW(p1.bind(p2));
+        auto p1Changes = cc.changeCount;
+        auto p2Changes = cc2.changeCount;
 
-        EXPECT_THROW(p1.bind(p2), std::logic_error);
-        EXPECT_NO_THROW(p1.bind(p2, BindMode::unidirectional));
+        p2 = []() {};
+        EXPECT_TRUE(p1.get() != nullptr);
+        EXPECT_EQ(cc.changeCount, p1Changes + 1);
+        EXPECT_EQ(cc2.changeCount, p2Changes + 1);
+
+        p1 = []() {};
+        EXPECT_EQ(cc.changeCount, p1Changes + 2);
+        EXPECT_EQ(cc2.changeCount, p2Changes + 2);
     }
 
     TEST(Property, onChange)
@@ -82,6 +100,32 @@ namespace bdn
         EXPECT_EQ(cc.changeCount, 1);
     }
 
+    TEST(Property, onChangeOnQueue)
+    {
+        auto queue = std::make_shared<DispatchQueue>(false);
+
+        for (auto policy : {CoalescePolicy::None, CoalescePolicy::LatestOnly}) {
+            Property<int> property(0);
+            std::vector<int> seen;
+            property.onChange().subscribe([&](Property<int> &changed) { seen.push_back(changed.get()); }, queue,
+                                          policy);
+
+            std::promise<void> release;
+            queue->dispatchAsync([released = release.get_future().share()]() { released.wait(); });
+            property = 1;
+            property = 2;
+            release.set_value();
+            queue->dispatchSync([]() {});
+
+            // The property itself is delivered, so both deliveries see its current value
+            if (policy == CoalescePolicy::None) {
+                EXPECT_EQ(seen, (std::vector<int>{2, 2}));
+            } else {
+                EXPECT_EQ(seen, (std::vector<int>{2}));
+            }
+        }
+    }
+
     TEST(Property, SimpleUnidirectionalBinding)
     {
         ChangeCounter<std::string> cc1, cc2;
@@ -158,4 +202,42 @@ namespace bdn
         Property<std::string> p2(SetterBacking<std::string>("Hello World"));
         EXPECT_EQ("Hello World", p2.get());
     }
+
+    TEST(Property, InlineValueDoesNotAllocate)
+    {
+        auto allocations = test::countAllocations([]() {
+            Property<int> p1;
+            Property<int> p2 = 42;
+            p1 = p2;
+            p1.set(p1 + 1);
+            EXPECT_EQ(p1.get(), 43);
+        });
+        EXPECT_EQ(allocations, 0u);
+    }
+
+    TEST(Property, BackingCreatedLater)
+    {
+        Property<int> p1 = 1;
+        std::vector<int> changes;
+        p1.onChange() += [&changes](auto &property) { changes.push_back(property.get()); };
+
+        p1 = 2;
+        p1 = 2;
+        EXPECT_EQ(changes, (std::vector<int>{2}));
+
+        // Binding moves the value into a backing, subscribers stay
+        Property<int> p2 = 3;
+        p1.bind(p2, BindMode::unidirectional);
+        EXPECT_EQ(changes, (std::vector<int>{2, 3}));
+
+        p2 = 4;
+        EXPECT_EQ(p1.get(), 4);
+        EXPECT_EQ(changes, (std::vector<int>{2, 3, 4}));
+
+        Property<int> p3 = 5;
+        auto backing = p3.backing();
+        EXPECT_EQ(backing->get(), 5);
+        p3 = 6;
+        EXPECT_EQ(backing->get(), 6);
+    }
 }
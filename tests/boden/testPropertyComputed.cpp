@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+
+#include <bdn/property/Property.h>
+#include <bdn/property/PropertyTransaction.h>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std::string_literals;
+
+namespace bdn
+{
+    TEST(PropertyComputed, Cached)
+    {
+        Property<std::string> first = "Ada"s;
+        Property<std::string> last = "Lovelace"s;
+        int computations = 0;
+
+        Property<std::string> title(ComputedBacking<std::string>([&]() {
+            computations++;
+            return first.get() + " " + last.get();
+        }));
+        EXPECT_EQ(computations, 1);
+
+        EXPECT_EQ(title.get(), "Ada Lovelace");
+        EXPECT_EQ(title.get(), "Ada Lovelace");
+        EXPECT_EQ(computations, 1);
+
+        // Nobody observes title, so it only recomputes when read
+        first = "Grace"s;
+        last = "Hopper"s;
+        EXPECT_EQ(computations, 1);
+        EXPECT_EQ(title.get(), "Grace Hopper");
+        EXPECT_EQ(computations, 2);
+
+        EXPECT_THROW(title = "Someone"s, std::logic_error);
+    }
+
+    TEST(PropertyComputed, NotifiesOnlyRealChanges)
+    {
+        Property<int> count = 0;
+        Property<bool> visible(ComputedBacking<bool>([&]() { return count > 0; }));
+
+        std::vector<bool> changes;
+        visible.onChange() += [&](auto &p) { changes.push_back(p.get()); };
+
+        count = 1;
+        count = 2;
+        count = 3;
+        count = 0;
+        EXPECT_EQ(changes, (std::vector<bool>{true, false}));
+    }
+
+    TEST(PropertyComputed, DynamicDependencies)
+    {
+        Property<bool> useA = true;
+        Property<int> a = 1;
+        Property<int> b = 2;
+        int computations = 0;
+
+        Property<int> selected(ComputedBacking<int>([&]() {
+            computations++;
+            return useA ? a.get() : b.get();
+        }));
+        int changes = 0;
+        selected.onChange() += [&](auto &) { changes++; };
+
+        b = 20;
+        EXPECT_EQ(computations, 1);
+
+        useA = false;
+        EXPECT_EQ(selected.get(), 20);
+        EXPECT_EQ(computations, 2);
+
+        // a is no dependency anymore
+        a = 10;
+        EXPECT_EQ(computations, 2);
+        EXPECT_EQ(changes, 1);
+    }
+
+    TEST(PropertyComputed, Chained)
+    {
+        Property<int> base = 1;
+        Property<int> doubled(ComputedBacking<int>([&]() { return base * 2; }));
+        Property<int> plusOne(ComputedBacking<int>([&]() { return doubled + 1; }));
+
+        std::vector<int> changes;
+        plusOne.onChange() += [&](auto &p) { changes.push_back(p.get()); };
+
+        base = 5;
+        EXPECT_EQ(doubled.get(), 10);
+        EXPECT_EQ(changes, (std::vector<int>{11}));
+    }
+
+    TEST(PropertyComputed, BoundTarget)
+    {
+        Property<int> a = 1;
+        Property<int> b = 2;
+        Property<int> sum(ComputedBacking<int>([&]() { return a + b; }));
+
+        Property<int> target;
+        target.bind(sum, BindMode::unidirectional);
+        EXPECT_EQ(target.get(), 3);
+
+        a = 10;
+        EXPECT_EQ(target.get(), 12);
+    }
+
+    TEST(PropertyComputed, Transaction)
+    {
+        Property<int> a = 1;
+        Property<int> b = 2;
+        int computations = 0;
+        Property<int> sum(ComputedBacking<int>([&]() {
+            computations++;
+            return a + b;
+        }));
+
+        std::vector<int> changes;
+        sum.onChange() += [&](auto &p) { changes.push_back(p.get()); };
+
+        {
+            PropertyTransaction transaction;
+            a = 10;
+            b = 20;
+            EXPECT_EQ(computations, 1);
+            EXPECT_EQ(sum.get(), 30);
+            b = 30;
+        }
+
+        EXPECT_EQ(changes, (std::vector<int>{40}));
+        EXPECT_EQ(computations, 3);
+    }
+}
@@ -0,0 +1,193 @@
+#include <gtest/gtest.h>
+
+#include <bdn/property/PropagationScheduler.h>
+#include <bdn/property/Property.h>
+
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace bdn
+{
+    // A feeds b and c, d is computed from both
+    struct Diamond
+    {
+        Property<int> a = 1;
+        Property<int> b{ComputedBacking<int>([this]() { return a * 2; })};
+        Property<int> c{ComputedBacking<int>([this]() { return a * 3; })};
+        Property<int> d{ComputedBacking<int>([this]() {
+            computations++;
+            return b + c;
+        })};
+
+        int computations = 0;
+        std::vector<int> changes;
+
+        Diamond()
+        {
+            d.onChange() += [this](auto &p) { changes.push_back(p.get()); };
+        }
+    };
+
+    TEST(PropertyPropagation, DiamondWithoutScheduler)
+    {
+        Diamond diamond;
+        diamond.computations = 0;
+
+        // Depth first: d sees the new b with the old c first
+        diamond.a = 2;
+        EXPECT_EQ(diamond.changes, (std::vector<int>{7, 10}));
+        EXPECT_EQ(diamond.computations, 2);
+    }
+
+    TEST(PropertyPropagation, Diamond)
+    {
+        PropagationScheduler scheduler;
+        Diamond diamond;
+        diamond.computations = 0;
+
+        diamond.a = 2;
+        EXPECT_EQ(diamond.changes, (std::vector<int>{10}));
+        EXPECT_EQ(diamond.computations, 1);
+
+        diamond.a = 3;
+        EXPECT_EQ(diamond.changes, (std::vector<int>{10, 15}));
+        EXPECT_EQ(diamond.computations, 2);
+    }
+
+    TEST(PropertyPropagation, DiamondOfBindings)
+    {
+        PropagationScheduler scheduler;
+        Property<int> a = 1;
+        Property<int> b;
+        Property<int> c;
+        b.bind(a, BindMode::unidirectional);
+        c.bind(a, BindMode::unidirectional);
+
+        std::vector<int> changes;
+        Property<int> d(ComputedBacking<int>([&]() { return b * 10 + c; }));
+        d.onChange() += [&](auto &p) { changes.push_back(p.get()); };
+
+        a = 2;
+        EXPECT_EQ(changes, (std::vector<int>{22}));
+    }
+
+    // b is bound to a before a is bound to the end of a chain, so a only
+    // gets deeper after b was bound to it
+    struct LateDeepening
+    {
+        Property<int> a = 0;
+        Property<int> b;
+        Property<int> z0 = 0;
+        Property<int> z1;
+        Property<int> z2;
+        Property<int> e;
+        Property<int> d{ComputedBacking<int>([this]() { return b * 100 + e; })};
+
+        std::vector<int> changes;
+
+        LateDeepening()
+        {
+            b.bind(a, BindMode::unidirectional);
+            z1.bind(z0, BindMode::unidirectional);
+            z2.bind(z1, BindMode::unidirectional);
+            a.bind(z2, BindMode::unidirectional);
+            e.bind(z0, BindMode::unidirectional);
+            d.onChange() += [this](auto &p) { changes.push_back(p.get()); };
+        }
+    };
+
+    TEST(PropertyPropagation, BindingDeepensLater)
+    {
+        PropagationScheduler scheduler;
+        LateDeepening graph;
+
+        graph.z0 = 1;
+        EXPECT_EQ(graph.changes, (std::vector<int>{101}));
+        EXPECT_EQ(graph.d.get(), 101);
+    }
+
+    TEST(PropertyPropagation, BindingDeepensLaterWithoutScheduler)
+    {
+        LateDeepening graph;
+
+        graph.z0 = 1;
+        EXPECT_EQ(graph.changes, (std::vector<int>{100, 101}));
+    }
+
+    TEST(PropertyPropagation, ComputedReadsDeeperDependency)
+    {
+        PropagationScheduler scheduler;
+        Property<int> x = 0;
+        Property<int> flag;
+        Property<int> z1;
+        Property<int> z2;
+        Property<int> z3;
+        flag.bind(x, BindMode::unidirectional);
+        z1.bind(x, BindMode::unidirectional);
+        z2.bind(z1, BindMode::unidirectional);
+        z3.bind(z2, BindMode::unidirectional);
+
+        // Only reads z3 once flag is set, so it is updated before z3 follows
+        Property<int> c(ComputedBacking<int>([&]() { return flag != 0 ? z3.get() : -1; }));
+        std::vector<int> changes;
+        c.onChange() += [&](auto &p) { changes.push_back(p.get()); };
+
+        x = 1;
+        EXPECT_EQ(changes, (std::vector<int>{0, 1}));
+    }
+
+    TEST(PropertyPropagation, Cycle)
+    {
+        PropagationScheduler scheduler;
+        Property<int> a = 0;
+        Property<int> b = 0;
+        Property<int> c = 0;
+        b.bind(a, BindMode::unidirectional);
+        c.bind(b, BindMode::unidirectional);
+        a.bind(c, BindMode::unidirectional);
+
+        int aChanges = 0;
+        int cChanges = 0;
+        a.onChange() += [&](auto &) { aChanges++; };
+        c.onChange() += [&](auto &) { cChanges++; };
+
+        b = 5;
+        EXPECT_EQ(a.get(), 5);
+        EXPECT_EQ(c.get(), 5);
+        EXPECT_EQ(aChanges, 1);
+        EXPECT_EQ(cChanges, 1);
+    }
+
+    TEST(PropertyPropagation, CycleWithoutScheduler)
+    {
+        // std::function cannot be compared, so only the bindings end the cycle
+        Property<std::function<void()>> a;
+        Property<std::function<void()>> b;
+        Property<std::function<void()>> c;
+        b.bind(a, BindMode::unidirectional);
+        c.bind(b, BindMode::unidirectional);
+        a.bind(c, BindMode::unidirectional);
+
+        int aChanges = 0;
+        int bChanges = 0;
+        int cChanges = 0;
+        a.onChange() += [&](auto &) { aChanges++; };
+        b.onChange() += [&](auto &) { bChanges++; };
+        c.onChange() += [&](auto &) { cChanges++; };
+
+        b = []() {};
+        EXPECT_TRUE(a.get() != nullptr);
+        EXPECT_EQ(aChanges, 1);
+        EXPECT_EQ(bChanges, 1);
+        EXPECT_EQ(cChanges, 1);
+    }
+
+    TEST(PropertyPropagation, ComputedCycle)
+    {
+        std::shared_ptr<Backing<int>> self;
+        self = std::make_shared<ComputedBacking<int>>([&]() { return self->get() + 1; });
+        EXPECT_THROW(self->get(), std::logic_error);
+    }
+}
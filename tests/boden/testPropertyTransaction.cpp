@@ -0,0 +1,191 @@
+#include <gtest/gtest.h>
+
+#include <bdn/property/Property.h>
+#include <bdn/property/PropertyTransaction.h>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace bdn
+{
+    TEST(PropertyTransaction, Coalesce)
+    {
+        Property<int> inlineValue = 0;
+        Property<int> backed = 0;
+        backed.backing();
+
+        std::vector<std::string> changes;
+        inlineValue.onChange() += [&](auto &p) { changes.push_back("inline " + std::to_string(p.get())); };
+        backed.onChange() += [&](auto &p) { changes.push_back("backed " + std::to_string(p.get())); };
+
+        {
+            PropertyTransaction transaction;
+            EXPECT_TRUE(PropertyTransaction::isActive());
+
+            for (int i = 1; i <= 3; i++) {
+                backed = i;
+                inlineValue = i;
+            }
+            EXPECT_EQ(inlineValue.get(), 3);
+            EXPECT_TRUE(changes.empty());
+        }
+
+        EXPECT_FALSE(PropertyTransaction::isActive());
+        EXPECT_EQ(changes, (std::vector<std::string>{"backed 3", "inline 3"}));
+
+        // Without a transaction every change is notified
+        backed = 4;
+        backed = 5;
+        EXPECT_EQ(changes.size(), 4u);
+    }
+
+    TEST(PropertyTransaction, Nested)
+    {
+        Property<int> p = 0;
+        int changes = 0;
+        p.onChange() += [&](auto &) { changes++; };
+
+        PropertyTransaction outer;
+        {
+            PropertyTransaction inner;
+            p = 1;
+        }
+        p = 2;
+        EXPECT_EQ(changes, 0);
+
+        outer.commit();
+        EXPECT_EQ(changes, 1);
+        outer.commit();
+        EXPECT_EQ(changes, 1);
+    }
+
+    TEST(PropertyTransaction, BindingsFollowImmediately)
+    {
+        Property<int> source = 0;
+        Property<int> target = 0;
+        target.bind(source, BindMode::unidirectional);
+
+        std::vector<std::string> changes;
+        source.onChange() += [&](auto &p) { changes.push_back("source " + std::to_string(p.get())); };
+        target.onChange() += [&](auto &p) {
+            EXPECT_EQ(p.get(), source.get());
+            changes.push_back("target " + std::to_string(p.get()));
+        };
+
+        {
+            PropertyTransaction transaction;
+            source = 1;
+            EXPECT_EQ(target.get(), 1);
+            source = 2;
+            EXPECT_EQ(target.get(), 2);
+            EXPECT_TRUE(changes.empty());
+        }
+
+        EXPECT_EQ(changes, (std::vector<std::string>{"source 2", "target 2"}));
+    }
+
+    TEST(PropertyTransaction, NotifiesInDepthOrder)
+    {
+        Property<int> source = 0;
+        Property<int> target = 0;
+        target.bind(source, BindMode::unidirectional);
+
+        std::vector<std::string> changes;
+        source.onChange() += [&](auto &) { changes.push_back("source"); };
+        target.onChange() += [&](auto &) { changes.push_back("target"); };
+
+        {
+            PropertyTransaction transaction;
+            target = 5;
+            source = 1;
+        }
+
+        // target changed first, but depends on source
+        EXPECT_EQ(changes, (std::vector<std::string>{"source", "target"}));
+    }
+
+    TEST(PropertyTransaction, ChangesDuringCommit)
+    {
+        Property<int> first = 0;
+        Property<int> second = 0;
+        std::vector<std::string> changes;
+
+        first.onChange() += [&](auto &p) {
+            changes.push_back("first");
+            second = p.get() * 10;
+        };
+        second.onChange() += [&](auto &) { changes.push_back("second"); };
+
+        {
+            PropertyTransaction transaction;
+            second = 5;
+            first = 1;
+        }
+
+        // second was still pending when first changed it again
+        EXPECT_EQ(changes, (std::vector<std::string>{"second", "first", "second"}));
+        EXPECT_EQ(second.get(), 10);
+    }
+
+    TEST(PropertyTransaction, DestroyedBeforeCommit)
+    {
+        auto property = std::make_unique<Property<int>>(0);
+        int changes = 0;
+        property->onChange() += [&](auto &) { changes++; };
+
+        {
+            PropertyTransaction transaction;
+            *property = 1;
+            property.reset();
+        }
+        EXPECT_EQ(changes, 0);
+    }
+
+    TEST(PropertyTransaction, ThrowingSubscriber)
+    {
+        Property<int> p = 0;
+        Property<int> other = 0;
+        int otherChanges = 0;
+        p.onChange() += [](auto &) { throw std::runtime_error("subscriber"); };
+        other.onChange() += [&](auto &) { otherChanges++; };
+
+        PropertyTransaction transaction;
+        p = 1;
+        other = 1;
+        EXPECT_THROW(transaction.commit(), std::runtime_error);
+        EXPECT_FALSE(PropertyTransaction::isActive());
+        EXPECT_EQ(otherChanges, 0);
+
+        other = 2;
+        EXPECT_EQ(otherChanges, 1);
+    }
+
+    TEST(PropertyTransaction, DestructorIgnoresThrowingSubscriber)
+    {
+        Property<int> p = 0;
+        p.onChange() += [](auto &) { throw std::runtime_error("subscriber"); };
+
+        EXPECT_NO_THROW({
+            PropertyTransaction transaction;
+            p = 1;
+        });
+        EXPECT_FALSE(PropertyTransaction::isActive());
+    }
+
+    TEST(PropertyTransaction, PerThread)
+    {
+        Property<int> p = 0;
+        int changes = 0;
+        p.onChange() += [&](auto &) { changes++; };
+
+        PropertyTransaction transaction;
+        std::thread([&]() {
+            EXPECT_FALSE(PropertyTransaction::isActive());
+            p = 1;
+        }).join();
+        EXPECT_EQ(changes, 1);
+    }
+}
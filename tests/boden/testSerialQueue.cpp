@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+
+#include <bdn/SerialQueue.h>
+#include <bdn/ThreadPool.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace bdn
+{
+    TEST(SerialQueue, Fifo)
+    {
+        auto pool = std::make_shared<ThreadPool>(4);
+        auto queue = std::make_shared<SerialQueue>(pool, 8);
+
+        std::vector<int> order;
+        const int count = 1000;
+        for (int i = 0; i < count; i++) {
+            queue->dispatchAsync([&, i]() { order.push_back(i); });
+        }
+        queue->dispatchSync([]() {});
+
+        ASSERT_EQ(order.size(), static_cast<size_t>(count));
+        for (int i = 0; i < count; i++) {
+            EXPECT_EQ(order[i], i);
+        }
+    }
+
+    TEST(SerialQueue, NeverConcurrent)
+    {
+        auto pool = std::make_shared<ThreadPool>(4);
+        auto queue = std::make_shared<SerialQueue>(pool, 4);
+
+        std::atomic<int> running{0};
+        std::atomic<int> maxRunning{0};
+        std::atomic<int> done{0};
+        const int producers = 4;
+        const int perProducer = 500;
+
+        std::vector<std::thread> threads;
+        for (int p = 0; p < producers; p++) {
+            threads.emplace_back([&]() {
+                for (int i = 0; i < perProducer; i++) {
+                    queue->dispatchAsync([&]() {
+                        EXPECT_TRUE(queue->isCurrent());
+                        int now = ++running;
+                        int max = maxRunning;
+                        while (now > max && !maxRunning.compare_exchange_weak(max, now)) {
+                        }
+                        running--;
+                        done++;
+                    });
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+
+        queue->dispatchSync([]() {});
+        EXPECT_EQ(done, producers * perProducer);
+        EXPECT_EQ(maxRunning, 1);
+        EXPECT_FALSE(queue->isCurrent());
+    }
+
+    TEST(SerialQueue, ManyQueuesShareFewThreads)
+    {
+        auto pool = std::make_shared<ThreadPool>(2);
+        std::vector<std::shared_ptr<SerialQueue>> queues;
+        for (int i = 0; i < 100; i++) {
+            queues.push_back(std::make_shared<SerialQueue>(pool));
+        }
+
+        std::vector<int> sums(queues.size());
+        for (int round = 0; round < 10; round++) {
+            for (size_t q = 0; q < queues.size(); q++) {
+                queues[q]->dispatchAsync([&sums, q, round]() {
+                    // Each queue sees its rounds in order
+                    EXPECT_EQ(sums[q], round);
+                    sums[q]++;
+                });
+            }
+        }
+
+        for (size_t q = 0; q < queues.size(); q++) {
+            EXPECT_EQ(queues[q]->dispatchSync([&]() { return sums[q]; }), 10);
+        }
+    }
+
+    TEST(SerialQueue, Sync)
+    {
+        auto queue = std::make_shared<SerialQueue>(std::make_shared<ThreadPool>(2));
+
+        EXPECT_EQ(queue->dispatchSync([]() { return 42; }), 42);
+        EXPECT_THROW(queue->dispatchSync([]() { throw std::invalid_argument("test"); }), std::invalid_argument);
+
+        // Nested calls run right away instead of deadlocking
+        EXPECT_EQ(queue->dispatchSync([&]() { return queue->dispatchSync([]() { return 7; }); }), 7);
+    }
+
+    TEST(SerialQueue, PendingKeepsQueueAlive)
+    {
+        auto pool = std::make_shared<ThreadPool>(1);
+        std::promise<void> release;
+        auto released = release.get_future().share();
+        pool->dispatchAsync([released]() { released.wait(); });
+
+        std::promise<void> ran;
+        std::weak_ptr<SerialQueue> weak;
+        {
+            auto queue = std::make_shared<SerialQueue>(pool);
+            weak = queue;
+            queue->dispatchAsync([&]() { ran.set_value(); });
+        }
+        EXPECT_FALSE(weak.expired());
+
+        release.set_value();
+        EXPECT_EQ(ran.get_future().wait_for(5s), std::future_status::ready);
+    }
+}
@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+
+#include "AllocationCounter.h"
+
+#include <bdn/DispatchQueue.h>
+#include <bdn/Notifier.h>
+#include <bdn/Task.h>
+#include <bdn/log.h>
+
+#include <array>
+#include <functional>
+#include <future>
+#include <memory>
+
+namespace bdn
+{
+    using test::countAllocations;
+
+    TEST(Task, Call)
+    {
+        int calls = 0;
+        Task task = [&calls]() { calls++; };
+
+        ASSERT_TRUE(task);
+        task();
+        task();
+        EXPECT_EQ(calls, 2);
+
+        Task moved = std::move(task);
+        EXPECT_FALSE(task);
+        moved();
+        EXPECT_EQ(calls, 3);
+
+        moved = nullptr;
+        EXPECT_FALSE(moved);
+        EXPECT_THROW(moved(), std::bad_function_call);
+    }
+
+    TEST(Task, Empty)
+    {
+        std::function<void()> empty;
+        void (*nullFunction)() = nullptr;
+
+        EXPECT_FALSE(Task(empty));
+        EXPECT_FALSE(Task(nullFunction));
+        EXPECT_TRUE(Task(std::function<void()>([]() {})));
+    }
+
+    TEST(Task, MoveOnlyCapture)
+    {
+        std::promise<int> promise;
+        auto future = promise.get_future();
+        auto value = std::make_unique<int>(42);
+
+        Task task = [promise = std::move(promise), value = std::move(value)]() mutable {
+            promise.set_value(*value);
+        };
+        Task moved = std::move(task);
+        moved();
+
+        EXPECT_EQ(future.get(), 42);
+    }
+
+    TEST(Task, DestroysCapture)
+    {
+        auto shared = std::make_shared<int>(0);
+        {
+            Task task = [shared]() {};
+            Task moved = std::move(task);
+            EXPECT_EQ(shared.use_count(), 2);
+        }
+        EXPECT_EQ(shared.use_count(), 1);
+
+        std::array<char, 256> large{};
+        {
+            Task task = [shared, large]() {};
+            Task moved = std::move(task);
+            EXPECT_EQ(shared.use_count(), 2);
+        }
+        EXPECT_EQ(shared.use_count(), 1);
+    }
+
+    TEST(Task, UniqueFunctionReturnAndArguments)
+    {
+        UniqueFunction<int(int, int)> add = [](int a, int b) { return a + b; };
+        EXPECT_EQ(add(2, 3), 5);
+
+        auto owned = std::make_unique<int>(10);
+        UniqueFunction<int(int), 16> scaled = [owned = std::move(owned)](int x) { return x * *owned; };
+        EXPECT_EQ(scaled(3), 30);
+    }
+
+    TEST(Task, NotifierMoveOnlyTarget)
+    {
+        Notifier<int> notifier;
+        auto sum = std::make_unique<int>(0);
+        int *result = sum.get();
+
+        notifier += [sum = std::move(sum)](int value) { *sum += value; };
+        notifier.notify(3);
+        notifier.notify(4);
+
+        EXPECT_EQ(*result, 7);
+    }
+
+    TEST(Task, NotifierAllocations)
+    {
+        Notifier<int> notifier;
+        int sum = 0;
+
+        auto allocations = countAllocations([&]() {
+            auto first = notifier.subscribe([&sum](int value) { sum += value; });
+            notifier.subscribe([&sum](int value) { sum -= value; });
+            for (int i = 0; i < 100; i++) {
+                notifier.notify(i);
+            }
+            notifier.unsubscribe(first);
+            notifier.subscribe([&sum](int value) { sum += 2 * value; });
+            notifier.notify(1);
+        });
+
+        // One or two subscribers live inside the notifier
+        EXPECT_EQ(allocations, 0u);
+        EXPECT_EQ(sum, 1);
+    }
+
+    TEST(Task, Allocations)
+    {
+        auto first = std::make_shared<int>(1);
+        auto second = std::make_shared<std::string>("capture");
+        int counter = 0;
+        auto typical = [first, second, &counter]() { counter += *first; };
+
+        auto functionAllocations = countAllocations([&]() {
+            std::function<void()> function = typical;
+            std::function<void()> moved = std::move(function);
+            moved();
+        });
+
+        auto taskAllocations = countAllocations([&]() {
+            Task task = typical;
+            Task moved = std::move(task);
+            moved();
+        });
+
+        EXPECT_EQ(taskAllocations, 0u);
+        EXPECT_EQ(counter, 2);
+
+        DispatchQueue queue(true);
+        const size_t dispatches = 1000;
+        auto dispatchAllocations = countAllocations([&]() {
+            for (size_t i = 0; i < dispatches; i++) {
+                queue.dispatchAsync(typical);
+            }
+            for (size_t i = 0; i < dispatches; i++) {
+                queue.executeSync();
+            }
+        });
+
+        EXPECT_EQ(counter, 2 + static_cast<int>(dispatches));
+
+        // Only the queue node remains
+        EXPECT_LE(dispatchAllocations, dispatches);
+
+        logstream() << "Allocations for a lambda capturing two shared_ptrs: std::function " << functionAllocations
+                    << ", Task " << taskAllocations << ", per dispatchAsync "
+                    << static_cast<double>(dispatchAllocations) / dispatches;
+    }
+}
@@ -0,0 +1,205 @@
+#include <gtest/gtest.h>
+
+#include <bdn/DispatchQueue.h>
+#include <bdn/ThreadPool.h>
+#include <bdn/WorkStealingDeque.h>
+
+#include <atomic>
+#include <future>
+#include <numeric>
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace bdn
+{
+    TEST(WorkStealingDeque, OwnerIsLifo)
+    {
+        WorkStealingDeque<int> deque(2);
+        for (int i = 0; i < 10; i++) {
+            deque.push(i);
+        }
+
+        int value = -1;
+        EXPECT_TRUE(deque.steal(value));
+        EXPECT_EQ(value, 0);
+
+        for (int i = 9; i > 0; i--) {
+            EXPECT_TRUE(deque.pop(value));
+            EXPECT_EQ(value, i);
+        }
+        EXPECT_FALSE(deque.pop(value));
+        EXPECT_TRUE(deque.empty());
+    }
+
+    TEST(WorkStealingDeque, ConcurrentSteal)
+    {
+        const int count = 100000;
+        WorkStealingDeque<int> deque;
+        std::atomic<bool> done{false};
+        std::vector<std::vector<int>> stolen(3);
+
+        std::vector<std::thread> thieves;
+        for (auto &bucket : stolen) {
+            thieves.emplace_back([&deque, &done, &bucket]() {
+                int value;
+                while (!done || !deque.empty()) {
+                    if (deque.steal(value)) {
+                        bucket.push_back(value);
+                    }
+                }
+            });
+        }
+
+        std::vector<int> popped;
+        int value;
+        for (int i = 0; i < count; i++) {
+            deque.push(i);
+            if (i % 3 == 0 && deque.pop(value)) {
+                popped.push_back(value);
+            }
+        }
+        done = true;
+        for (auto &thief : thieves) {
+            thief.join();
+        }
+        while (deque.pop(value)) {
+            popped.push_back(value);
+        }
+
+        std::set<int> seen(popped.begin(), popped.end());
+        size_t total = popped.size();
+        for (auto &bucket : stolen) {
+            seen.insert(bucket.begin(), bucket.end());
+            total += bucket.size();
+        }
+
+        EXPECT_EQ(total, static_cast<size_t>(count));
+        EXPECT_EQ(seen.size(), static_cast<size_t>(count));
+    }
+
+    TEST(ThreadPool, RunsAll)
+    {
+        ThreadPool pool(4);
+        EXPECT_EQ(pool.threadCount(), 4u);
+
+        std::atomic<int> counter{0};
+        std::promise<void> finished;
+        const int count = 1000;
+
+        for (int i = 0; i < count; i++) {
+            pool.dispatchAsync([&]() {
+                if (++counter == count) {
+                    finished.set_value();
+                }
+            });
+        }
+
+        EXPECT_EQ(finished.get_future().wait_for(5s), std::future_status::ready);
+    }
+
+    TEST(ThreadPool, NestedDispatch)
+    {
+        ThreadPool pool(3);
+
+        std::atomic<int> counter{0};
+        std::promise<void> finished;
+        const int fanOut = 100;
+
+        pool.dispatchAsync([&]() {
+            EXPECT_TRUE(pool.isWorkerThread());
+            for (int i = 0; i < fanOut; i++) {
+                pool.dispatchAsync([&]() {
+                    if (++counter == fanOut) {
+                        finished.set_value();
+                    }
+                });
+            }
+        });
+
+        EXPECT_FALSE(pool.isWorkerThread());
+        EXPECT_EQ(finished.get_future().wait_for(5s), std::future_status::ready);
+    }
+
+    TEST(ThreadPool, Completion)
+    {
+        auto queue = std::make_shared<DispatchQueue>();
+        ThreadPool pool(2, queue);
+
+        auto queueThread = queue->dispatchSync([]() { return std::this_thread::get_id(); });
+
+        std::promise<std::pair<int, std::thread::id>> result;
+        pool.dispatchAsync([]() { return std::make_unique<int>(42); },
+                           [&](std::unique_ptr<int> value) {
+                               result.set_value({*value, std::this_thread::get_id()});
+                           });
+
+        auto future = result.get_future();
+        ASSERT_EQ(future.wait_for(5s), std::future_status::ready);
+        auto [value, threadId] = future.get();
+        EXPECT_EQ(value, 42);
+        EXPECT_EQ(threadId, queueThread);
+    }
+
+    TEST(ThreadPool, ParallelFor)
+    {
+        ThreadPool pool(4);
+
+        std::vector<int> values(10007);
+        pool.parallelFor(size_t(0), values.size(), [&](size_t i) { values[i] = static_cast<int>(i); });
+
+        for (size_t i = 0; i < values.size(); i++) {
+            ASSERT_EQ(values[i], static_cast<int>(i));
+        }
+
+        std::atomic<long long> sum{0};
+        pool.parallelFor(0, 100, [&](int i) {
+            pool.parallelFor(0, 100, [&](int j) { sum += i * j; }, 7);
+        });
+        EXPECT_EQ(sum, 4950LL * 4950LL);
+    }
+
+    TEST(ThreadPool, ParallelForOnlyRunsOwnChunks)
+    {
+        ThreadPool pool(1);
+
+        std::promise<void> release;
+        auto released = release.get_future().share();
+        std::promise<void> blocking;
+        pool.dispatchAsync([released, &blocking]() {
+            blocking.set_value();
+            released.wait();
+        });
+        blocking.get_future().wait();
+
+        std::promise<std::thread::id> unrelated;
+        auto unrelatedThread = unrelated.get_future();
+        pool.dispatchAsync([&unrelated]() { unrelated.set_value(std::this_thread::get_id()); });
+
+        // The only worker is busy, so the calling thread has to run every
+        // chunk, but must not pick up the unrelated function meanwhile.
+        std::set<std::thread::id> threads;
+        pool.parallelFor(0, 100, [&](int) { threads.insert(std::this_thread::get_id()); }, 1);
+        EXPECT_EQ(threads, std::set<std::thread::id>{std::this_thread::get_id()});
+
+        release.set_value();
+        ASSERT_EQ(unrelatedThread.wait_for(5s), std::future_status::ready);
+        EXPECT_NE(unrelatedThread.get(), std::this_thread::get_id());
+    }
+
+    TEST(ThreadPool, ParallelForException)
+    {
+        ThreadPool pool(2);
+
+        EXPECT_THROW(pool.parallelFor(0, 1000,
+                                      [](int i) {
+                                          if (i == 500) {
+                                              throw std::invalid_argument("test");
+                                          }
+                                      },
+                                      10),
+                     std::invalid_argument);
+    }
+}
@@ -1,8 +1,12 @@
 #include <bdn/Timer.h>
+#include <bdn/VirtualClock.h>
 #include <chrono>
 #include <condition_variable>
 #include <gtest/gtest.h>
+#include <memory>
 #include <mutex>
+#include <set>
+#include <vector>
 
 using namespace std::chrono_literals;
 
@@ -61,4 +65,86 @@ namespace bdn
         bool result = tc.waitFor(10);
         EXPECT_EQ(result, true);
     }
+
+    TEST(Timer, StopCancelsPendingTrigger)
+    {
+        auto clock = std::make_shared<VirtualClock>();
+        auto queue = std::make_shared<DispatchQueue>(true, clock);
+
+        Timer t(queue);
+        t.interval = 20ms;
+        t.repeat = true;
+
+        int triggers = 0;
+        t.onTriggered() += [&triggers]() { triggers++; };
+
+        for (int i = 0; i < 100; i++) {
+            t.restart();
+        }
+        t.stop();
+
+        clock->advanceBy(1s);
+        EXPECT_EQ(triggers, 0);
+    }
+
+    TEST(Timer, ToleranceDelaysAtMostByTolerance)
+    {
+        auto clock = std::make_shared<VirtualClock>();
+        auto queue = std::make_shared<DispatchQueue>(true, clock);
+
+        Timer t(queue);
+        t.interval = 20ms;
+        t.tolerance = 40ms;
+
+        std::vector<DispatchQueue::TimePoint> triggeredAt;
+        t.onTriggered() += [&]() { triggeredAt.push_back(clock->now()); };
+
+        auto start = clock->now();
+        t.start();
+        clock->advanceBy(1s);
+
+        ASSERT_EQ(triggeredAt.size(), 1u);
+        EXPECT_GE(triggeredAt[0] - start, 20ms);
+        EXPECT_LE(triggeredAt[0] - start, 20ms + 40ms);
+    }
+
+    // Returns how many distinct points in time the queue had to wake up at
+    // to serve 20 repeating timers for a second.
+    static size_t countWakeups(Timer::Duration tolerance)
+    {
+        const int timerCount = 20;
+
+        auto clock = std::make_shared<VirtualClock>();
+        auto queue = std::make_shared<DispatchQueue>(true, clock);
+
+        std::set<DispatchQueue::TimePoint> wakeups;
+        std::vector<std::unique_ptr<Timer>> timers;
+        for (int i = 0; i < timerCount; i++) {
+            auto timer = std::make_unique<Timer>(queue);
+            timer->interval = 50ms;
+            timer->tolerance = tolerance;
+            timer->repeat = true;
+            timer->onTriggered() += [&]() { wakeups.insert(clock->now()); };
+            timers.push_back(std::move(timer));
+        }
+
+        // Spread the phases so that every timer has its own deadline
+        for (auto &timer : timers) {
+            timer->start();
+            clock->advanceBy(2ms);
+        }
+
+        wakeups.clear();
+        clock->advanceBy(1s);
+        return wakeups.size();
+    }
+
+    TEST(Timer, CoalescingWakeups)
+    {
+        auto exactWakeups = countWakeups(0ms);
+        auto coalescedWakeups = countWakeups(25ms);
+
+        EXPECT_EQ(exactWakeups, 20u * 20u);
+        EXPECT_LT(coalescedWakeups * 2, exactWakeups);
+    }
 }
@@ -0,0 +1,180 @@
+#include <gtest/gtest.h>
+
+#include <bdn/TimingWheel.h>
+
+#include <map>
+#include <random>
+
+using namespace std::chrono_literals;
+
+namespace bdn
+{
+    using Clock = std::chrono::steady_clock;
+    using Wheel = TimingWheel<int, Clock>;
+
+    static bool popAndFinish(Wheel &wheel, Clock::time_point now, int &value)
+    {
+        if (auto handle = wheel.popExpired(now, value)) {
+            wheel.finish(*handle);
+            return true;
+        }
+        return false;
+    }
+
+    TEST(TimingWheel, Empty)
+    {
+        Wheel wheel(Clock::time_point{});
+        int value = 0;
+
+        EXPECT_TRUE(wheel.empty());
+        EXPECT_FALSE(wheel.nextDeadline());
+        EXPECT_FALSE(wheel.popExpired(Clock::time_point{} + 1h, value));
+    }
+
+    TEST(TimingWheel, DeadlineOrder)
+    {
+        auto start = Clock::time_point{};
+        Wheel wheel(start);
+
+        wheel.insert(start + 30ms, 3);
+        wheel.insert(start + 10ms, 1);
+        wheel.insert(start + 20ms, 2);
+        wheel.insert(start + 10ms, 4);
+        EXPECT_EQ(wheel.size(), 4u);
+
+        EXPECT_EQ(*wheel.nextDeadline(), start + 10ms);
+
+        int value = 0;
+        EXPECT_FALSE(popAndFinish(wheel, start + 9ms, value));
+
+        std::vector<int> order;
+        while (popAndFinish(wheel, start + 30ms, value)) {
+            order.push_back(value);
+        }
+
+        EXPECT_EQ(order, (std::vector<int>{1, 4, 2, 3}));
+        EXPECT_TRUE(wheel.empty());
+    }
+
+    TEST(TimingWheel, SubTickPrecision)
+    {
+        auto start = Clock::time_point{};
+        Wheel wheel(start);
+
+        wheel.insert(start + 1500us, 1);
+        EXPECT_EQ(*wheel.nextDeadline(), start + 1500us);
+
+        int value = 0;
+        EXPECT_FALSE(popAndFinish(wheel, start + 1400us, value));
+        EXPECT_TRUE(popAndFinish(wheel, start + 1500us, value));
+    }
+
+    TEST(TimingWheel, Cascade)
+    {
+        auto start = Clock::time_point{};
+        Wheel wheel(start);
+
+        wheel.insert(start + 3h + 250ms, 2);
+        wheel.insert(start + 5s, 1);
+
+        auto next = wheel.nextDeadline();
+        ASSERT_TRUE(next);
+        EXPECT_LE(*next, start + 5s);
+
+        int value = 0;
+        EXPECT_FALSE(popAndFinish(wheel, start + 4999ms, value));
+        EXPECT_TRUE(popAndFinish(wheel, start + 5s, value));
+        EXPECT_EQ(value, 1);
+
+        EXPECT_FALSE(popAndFinish(wheel, start + 3h + 249ms, value));
+        EXPECT_TRUE(popAndFinish(wheel, start + 3h + 250ms, value));
+        EXPECT_EQ(value, 2);
+    }
+
+    TEST(TimingWheel, Cancel)
+    {
+        auto start = Clock::time_point{};
+        Wheel wheel(start);
+
+        auto first = wheel.insert(start + 10ms, 1);
+        auto second = wheel.insert(start + 20ms, 2);
+
+        EXPECT_TRUE(wheel.cancel(first));
+        EXPECT_FALSE(wheel.cancel(first));
+        EXPECT_EQ(wheel.size(), 1u);
+        EXPECT_EQ(*wheel.nextDeadline(), start + 20ms);
+
+        // Stale handles must not match a reused entry
+        auto third = wheel.insert(start + 30ms, 3);
+        EXPECT_FALSE(wheel.cancel(first));
+
+        int value = 0;
+        EXPECT_TRUE(popAndFinish(wheel, start + 1s, value));
+        EXPECT_EQ(value, 2);
+        EXPECT_FALSE(wheel.cancel(second));
+        EXPECT_TRUE(popAndFinish(wheel, start + 1s, value));
+        EXPECT_EQ(value, 3);
+        EXPECT_FALSE(wheel.cancel(third));
+        EXPECT_TRUE(wheel.empty());
+    }
+
+    TEST(TimingWheel, CancelWhileRunning)
+    {
+        auto start = Clock::time_point{};
+        Wheel wheel(start);
+
+        auto handle = wheel.insert(start + 10ms, 1);
+
+        int value = 0;
+        auto running = wheel.popExpired(start + 10ms, value);
+        ASSERT_TRUE(running);
+        EXPECT_TRUE(wheel.reschedule(*running, start + 20ms, value));
+        EXPECT_EQ(*wheel.nextDeadline(), start + 20ms);
+
+        running = wheel.popExpired(start + 20ms, value);
+        ASSERT_TRUE(running);
+        EXPECT_TRUE(wheel.cancel(handle));
+        EXPECT_FALSE(wheel.reschedule(*running, start + 30ms, value));
+        EXPECT_TRUE(wheel.empty());
+        EXPECT_FALSE(wheel.nextDeadline());
+    }
+
+    TEST(TimingWheel, MatchesReference)
+    {
+        std::mt19937 random(42);
+        auto now = Clock::time_point{} + 17ms;
+        Wheel wheel(now);
+        std::multimap<Clock::time_point, int> reference;
+
+        int nextValue = 0;
+        for (int round = 0; round < 2000; round++) {
+            int inserts = static_cast<int>(random() % 5);
+            for (int i = 0; i < inserts; i++) {
+                auto range = (random() % 4 == 0) ? 200000000 : 200000;
+                auto deadline = now + std::chrono::microseconds(random() % range);
+                wheel.insert(deadline, nextValue);
+                reference.emplace(deadline, nextValue);
+                nextValue++;
+            }
+
+            if (!reference.empty()) {
+                auto next = wheel.nextDeadline();
+                ASSERT_TRUE(next);
+                ASSERT_LE(*next, reference.begin()->first);
+            }
+
+            now += std::chrono::microseconds(random() % 300000);
+
+            int value = 0;
+            while (popAndFinish(wheel, now, value)) {
+                ASSERT_FALSE(reference.empty());
+                ASSERT_EQ(reference.begin()->second, value);
+                ASSERT_LE(reference.begin()->first, now);
+                reference.erase(reference.begin());
+            }
+
+            ASSERT_TRUE(reference.empty() || reference.begin()->first > now);
+            ASSERT_EQ(wheel.size(), reference.size());
+        }
+    }
+}
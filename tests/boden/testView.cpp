@@ -0,0 +1,36 @@
+#include <gtest/gtest.h>
+
+#include "AllocationCounter.h"
+
+#include <bdn/log.h>
+#include <bdn/ui/View.h>
+#include <bdn/ui/ViewCoreFactory.h>
+
+#include <memory>
+#include <vector>
+
+namespace bdn
+{
+    using namespace bdn::ui;
+
+    TEST(View, BytesPerView)
+    {
+        auto factory = std::make_shared<ViewCoreFactory>();
+        const size_t count = 2000;
+        std::vector<std::shared_ptr<View>> views;
+        views.reserve(count);
+
+        auto bytesBefore = test::liveAllocatedBytes();
+        auto allocationsBefore = test::allocationCount();
+        for (size_t i = 0; i < count; i++) {
+            views.push_back(std::make_shared<View>(factory));
+        }
+        auto bytes = (test::liveAllocatedBytes() - bytesBefore) / count;
+        auto allocations = (test::allocationCount() - allocationsBefore) / count;
+
+        EXPECT_GE(bytes, sizeof(View));
+
+        logstream() << "View: " << bytes << " bytes in " << allocations << " allocations per View, sizeof(View) "
+                    << sizeof(View);
+    }
+}
@@ -0,0 +1,155 @@
+#include <gtest/gtest.h>
+
+#include <bdn/GenericApplication.h>
+#include <bdn/Timer.h>
+#include <bdn/VirtualClock.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace bdn
+{
+    TEST(VirtualClock, DelayedRunInDeadlineOrder)
+    {
+        auto clock = std::make_shared<VirtualClock>();
+        DispatchQueue queue(true, clock);
+        auto start = clock->now();
+
+        std::vector<int> order;
+        std::vector<DispatchQueue::TimePoint> times;
+        for (int delay : {30, 10, 20}) {
+            queue.dispatchAsyncDelayed(std::chrono::milliseconds(delay), [&, delay]() {
+                order.push_back(delay);
+                times.push_back(clock->now());
+            });
+        }
+
+        clock->advanceBy(15ms);
+        EXPECT_EQ(order, (std::vector<int>{10}));
+        EXPECT_EQ(clock->now(), start + 15ms);
+
+        clock->advanceBy(1h);
+        EXPECT_EQ(order, (std::vector<int>{10, 20, 30}));
+        ASSERT_EQ(times.size(), 3u);
+        for (size_t i = 0; i < times.size(); i++) {
+            EXPECT_EQ(times[i], start + std::chrono::milliseconds(order[i]));
+        }
+    }
+
+    TEST(VirtualClock, AsyncRunsWithoutAdvancing)
+    {
+        auto clock = std::make_shared<VirtualClock>();
+        DispatchQueue queue(true, clock);
+        auto start = clock->now();
+
+        bool called = false;
+        queue.dispatchAsync([&]() { called = true; });
+        clock->runDue();
+
+        EXPECT_TRUE(called);
+        EXPECT_EQ(clock->now(), start);
+    }
+
+    TEST(VirtualClock, LongHorizonTimer)
+    {
+        auto clock = std::make_shared<VirtualClock>();
+        DispatchQueue queue(true, clock);
+        auto start = clock->now();
+
+        uint64_t ticks = 0;
+        uint64_t missed = 0;
+        queue.createTimer(
+            1s,
+            [&](uint64_t missedTicks) {
+                ticks++;
+                missed += missedTicks;
+                EXPECT_EQ(clock->now(), start + std::chrono::seconds(ticks));
+                return true;
+            },
+            DispatchQueue::MissedTickPolicy::Coalesce);
+
+        // Three hours of a periodic refresh
+        auto wallStart = DispatchQueue::Clock::now();
+        clock->advanceBy(3h);
+
+        EXPECT_EQ(ticks, 3u * 60 * 60);
+        EXPECT_EQ(missed, 0u);
+        EXPECT_LT(DispatchQueue::Clock::now() - wallStart, 30s);
+    }
+
+    TEST(VirtualClock, QueueWithThread)
+    {
+        auto clock = std::make_shared<VirtualClock>();
+        DispatchQueue queue(false, clock);
+
+        std::atomic<int> calls{0};
+        queue.dispatchAsyncDelayed(1min, [&]() { calls++; });
+        queue.dispatchAsyncDelayed(2min, [&]() { calls++; });
+
+        queue.dispatchSync([]() {});
+        EXPECT_EQ(calls, 0);
+
+        clock->advanceBy(90s);
+        EXPECT_EQ(calls, 1);
+
+        clock->advanceBy(30s);
+        EXPECT_EQ(calls, 2);
+    }
+
+    TEST(VirtualClock, WhenIdle)
+    {
+        auto clock = std::make_shared<VirtualClock>();
+        DispatchQueue queue(true, clock);
+
+        bool called = false;
+        queue.dispatchWhenIdle([&](const DispatchQueue::IdleDeadline &deadline) {
+            called = true;
+            EXPECT_FALSE(deadline.didTimeout);
+            // Virtual time stands still, so this is exactly the budget
+            EXPECT_EQ(deadline.timeRemaining(), DispatchQueue::DefaultProcessBudget);
+        });
+
+        clock->runDue();
+        EXPECT_TRUE(called);
+    }
+
+    TEST(VirtualClock, Timer)
+    {
+        auto clock = std::make_shared<VirtualClock>();
+        auto queue = std::make_shared<DispatchQueue>(true, clock);
+
+        Timer timer(queue);
+        int triggers = 0;
+        timer.onTriggered() += [&]() { triggers++; };
+        timer.interval = 1s;
+        timer.repeat = true;
+        timer.running = true;
+
+        clock->advanceBy(10s);
+        EXPECT_EQ(triggers, 10);
+
+        timer.running = false;
+        clock->advanceBy(10s);
+        EXPECT_EQ(triggers, 10);
+    }
+
+    TEST(VirtualClock, Application)
+    {
+        auto clock = std::make_shared<VirtualClock>();
+        auto app = std::make_shared<GenericApplication>([]() { return nullptr; }, false, clock);
+        auto queue = app->dispatchQueue();
+        EXPECT_EQ(queue->timeSource(), clock);
+
+        bool called = false;
+        queue->dispatchAsyncDelayed(1s, [&]() { called = true; });
+        clock->advanceBy(1s);
+        EXPECT_TRUE(called);
+        EXPECT_EQ(queue->now(), clock->now());
+
+        queue->cancel();
+    }
+}